@@ -42,8 +42,7 @@ if [[ $# -gt 0 ]]; then
 		mkdir -p "$output"
 	fi
 
-	#run Evolution 30 times
-	for ((i = 0; i < 30; i++)); do
-		./build/src/GEHash "$@" "-o ${output}/output${i}.json"
-	done
-fi
\ No newline at end of file
+	#run Evolution 30 times in one process, outputs output0.json to
+	#output29.json
+	./build/src/GEHash "$@" --runs 30 -o "${output}/output.json"
+fi
@@ -0,0 +1,227 @@
+/**
+ * @file GEDataset.h
+ * @author Adam Freiberg (xfreib00@stud.fit.vutbr.cz)
+ * @brief Header file for GEDataset class
+ * @version 0.1
+ * @date 2021-07-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include "error/datasetError.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Class holding training data loaded into memory.
+ * @details Training data file is parsed once and all keys are stored in
+ * single contiguous array, so evaluation only iterates over it. Each line of
+ * text file contains 10 numbers separated by semicolons, where first 8 are
+ * words of IPv6 addresses and last two are 16-bit ports packed into last word
+ * of key.
+ *
+ * Binary files created by GEDataset::save (or gehash-convert tool) are not
+ * parsed at all, they are mapped read-only into memory, so concurrent runs
+ * share single copy in page cache. Binary format consists of header
+ * (GEDataset::Header) followed by packed keys, all in host byte order.
+ */
+class GEDataset {
+
+  public:
+    /// Type of single key.
+    using Key = std::array<uint32_t, 9>;
+
+    /**
+     * @brief Header of binary training data file.
+     */
+    struct Header {
+        /// File identification, always "GEHASHDS".
+        char magic[8];
+        /// Version of format.
+        uint32_t version;
+        /// Number of 32-bit words in single key.
+        uint32_t key_words;
+        /// Number of keys stored in file.
+        uint64_t count;
+        /// Reserved for future use, must be zero.
+        uint64_t reserved;
+    };
+
+    /// Current version of binary format.
+    static constexpr uint32_t format_version = 1;
+
+    /**
+     * @brief Default constructor creating empty dataset.
+     */
+    GEDataset() = default;
+
+    /**
+     * @brief Constructor loading training data from file.
+     * @param [in] path Path to training data file.
+     * @exception datasetOpenError File could not be opened.
+     * @exception datasetFormatError File contains invalid line.
+     */
+    explicit GEDataset(const std::string &path);
+
+    /**
+     * @brief Constructor creating stratified subsample of other dataset.
+     * @details Source keys are divided into consecutive strata of equal
+     * length and middle key of each stratum is copied, so sample covers whole
+     * file evenly (e.g. all traces concatenated into training data).
+     * @param [in] source Dataset to take sample from.
+     * @param [in] fraction Fraction of keys in sample, from 0 to 1. Sample
+     * contains at least one key if source is not empty.
+     */
+    GEDataset(const GEDataset &source, double fraction);
+
+    GEDataset(const GEDataset &) = delete;
+    GEDataset &operator=(const GEDataset &) = delete;
+
+    /**
+     * @brief Load training data from file, replacing current content.
+     * @details Format of file (text or binary) is detected automatically.
+     * @param [in] path Path to training data file.
+     * @exception datasetOpenError File could not be opened.
+     * @exception datasetFormatError File contains invalid line or binary
+     * header does not match file.
+     */
+    void load(const std::string &path);
+
+    /**
+     * @brief Save keys to binary training data file.
+     * @details File is written under temporary name and renamed, so it can
+     * be replaced while other processes are using it.
+     * @param [in] path Path to output file.
+     * @exception datasetOpenError File could not be written.
+     */
+    void save(const std::string &path) const;
+
+    /**
+     * @brief Compute fingerprint of keys.
+     * @details 64-bit FNV-1a over all words of all keys in order, used to
+     * detect change of training data (e.g. by persistent fitness cache).
+     * @return Fingerprint of keys.
+     */
+    uint64_t fingerprint(void) const;
+
+    /**
+     * @brief Check if dataset is mapped from binary file.
+     * @return True if keys are memory mapped.
+     */
+    bool isMapped(void) const { return map != nullptr; };
+
+    /**
+     * @brief Get pointer to first key.
+     * @return Pointer to first key.
+     */
+    const Key *begin(void) const { return first; };
+
+    /**
+     * @brief Get pointer behind last key.
+     * @return Pointer behind last key.
+     */
+    const Key *end(void) const { return first + count; };
+
+    /**
+     * @brief Get number of keys.
+     * @return Number of keys in dataset.
+     */
+    size_t size(void) const { return count; };
+
+    /**
+     * @brief Check if dataset is empty.
+     * @return True if there are no keys.
+     */
+    bool empty(void) const { return count == 0; };
+
+    /**
+     * @brief Get memory used by keys.
+     * @return Size of key array in bytes.
+     */
+    size_t bytes(void) const { return count * sizeof(Key); };
+
+    /**
+     * @brief Get duration of last load.
+     * @return Load time in seconds.
+     */
+    double loadTime(void) const { return load_time; };
+
+    /**
+     * @brief Get path of loaded file.
+     * @return Path to training data file.
+     */
+    const std::string &path(void) const { return d_path; };
+
+    /**
+     * @brief Destructor unmapping binary file.
+     */
+    ~GEDataset();
+
+  private:
+    /**
+     * @brief Parse text training data file.
+     * @param [in] path Path to training data file.
+     */
+    void loadText(const std::string &path);
+
+    /**
+     * @brief Map binary training data file into memory.
+     * @param [in] fd Descriptor of opened file.
+     */
+    void loadBinary(int fd);
+
+    /**
+     * @brief Release current content.
+     */
+    void clear(void);
+
+    /**
+     * @brief Parse single line of training data.
+     * @param [in] line Pointer to first character of line.
+     * @param [in] eol Pointer behind last character of line.
+     * @param [out] key Parsed key.
+     * @return False if line is not valid.
+     */
+    static bool parseLine(const char *line, const char *eol, Key &key);
+
+    /**
+     * @brief Array of all keys parsed from text file.
+     */
+    std::vector<Key> keys;
+
+    /**
+     * @brief Pointer to first key, either in keys or in mapped file.
+     */
+    const Key *first = nullptr;
+
+    /**
+     * @brief Number of keys.
+     */
+    size_t count = 0;
+
+    /**
+     * @brief Address of mapped binary file.
+     */
+    void *map = nullptr;
+
+    /**
+     * @brief Size of mapped binary file.
+     */
+    size_t map_size = 0;
+
+    /**
+     * @brief Path to training data file.
+     */
+    std::string d_path;
+
+    /**
+     * @brief Duration of last load in seconds.
+     */
+    double load_time = 0.0;
+};
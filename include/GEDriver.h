@@ -0,0 +1,281 @@
+/**
+ * @file GEDriver.h
+ * @author Adam Freiberg (xfreib00@stud.fit.vutbr.cz)
+ * @brief Header file for GEDriver class
+ * @version 0.1
+ * @date 2021-07-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include "GEEvaluatorBase.h"
+#include "GEPareto.h"
+#include "GEPersistentCache.h"
+#include "GEStats.h"
+#include "GEThreadPool.h"
+#include <cstdint>
+#include <gram/evaluation/driver/EvaluationDriver.h>
+#include <gram/individual/Individual.h>
+#include <gram/language/mapper/Mapper.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * @brief Source of fitness cutoff used for early abort of evaluation.
+ */
+enum class CutoffMode {
+    /// Individuals are always evaluated on whole training set.
+    None,
+    /// Worst fitness of previous generation.
+    Worst,
+    /// Fitness with which individual of previous generation had less than 1%
+    /// chance of winning tournament.
+    Tournament,
+    /// Fixed value given by user.
+    Value
+};
+
+/**
+ * @brief Stage of staged evaluation.
+ */
+struct GEStage {
+    /// Fraction of training data hashed in this stage.
+    double fraction;
+    /// Maximal ratio of fitness to fitness of random hash function with
+    /// which phenotype is promoted to next stage.
+    double threshold;
+};
+
+/**
+ * @brief Evaluation driver evaluating population on pool of threads.
+ * @details Individuals are mapped to phenotypes on calling thread and looked
+ * up in fitness cache. Each distinct phenotype which is not cached yet is
+ * then evaluated by one of workers. Every worker owns its evaluator, because
+ * evaluators (their hash tables and script engines) are not thread-safe.
+ * Fitness depends only on phenotype, so results are identical to
+ * single-threaded evaluation regardless of number of threads.
+ */
+class GEDriver : public gram::EvaluationDriver {
+
+  public:
+    /**
+     * @brief Constructor of GEDriver class.
+     * @param [in] mapper Unique pointer to mapper used to map genotypes.
+     * @param [in] evaluators Evaluators used by workers, one per thread.
+     * Number of threads is given by size of this vector.
+     */
+    GEDriver(std::unique_ptr<gram::Mapper> mapper,
+             std::vector<std::unique_ptr<GEEvaluatorBase>> evaluators);
+
+    /**
+     * @brief Set cutoff for early abort of evaluation.
+     * @details Cutoff of Worst and Tournament modes is derived from
+     * individuals of previous generation which were evaluated completely, so
+     * first generation is never truncated. Fitness of truncated evaluation
+     * is not cached, as it depends on cutoff.
+     * @param [in] mode Source of cutoff.
+     * @param [in] value Cutoff used in Value mode.
+     * @param [in] tournament Tournament size used in Tournament mode.
+     */
+    void setCutoff(CutoffMode mode, gram::Fitness value = 0.0,
+                   unsigned long tournament = 2);
+
+    /**
+     * @brief Set stages of evaluation on subsamples of training data.
+     * @details Every phenotype is first evaluated on sample of first stage
+     * and only phenotypes whose fitness ratio to random hash function is at
+     * most threshold of stage continue to next stage, and finally to
+     * evaluation on whole training set. Fitness of discarded phenotype is
+     * its ratio multiplied by expected fitness of random function on whole
+     * training set. Such estimate is cached, but it is never used as source
+     * of cutoff. Samples are given to evaluators by caller (see
+     * GEEvaluatorBase::evaluateStage), in the same order.
+     * @param [in] stages Stages in order of evaluation, empty disables
+     * staged evaluation.
+     */
+    void setStages(std::vector<GEStage> stages) {
+        this->stages = std::move(stages);
+    };
+
+    /**
+     * @brief Use canonical form of phenotypes as key of fitness cache.
+     * @details Phenotypes with the same canonical form (see canonicalForm)
+     * compute the same hash function, so only one of them is evaluated.
+     * Phenotypes which cannot be parsed are cached by their text.
+     * @param [in] magic Value of magic constant substituted into phenotypes.
+     */
+    void setCanonical(uint64_t magic) {
+        canonical = true;
+        this->magic = magic;
+    };
+
+    /**
+     * @brief Share fitness cache with other runs through file.
+     * @details Entries appended by other processes are loaded before each
+     * generation and fitness of phenotypes evaluated on whole training set
+     * is appended after it. Estimated fitness (truncated or discarded by
+     * stage) is not stored. Cache is disabled with warning if file cannot be
+     * read or written.
+     * @param [in] file Opened cache file.
+     */
+    void setPersistentCache(std::unique_ptr<GEPersistentCache> file) {
+        persistent = std::move(file);
+    };
+
+    /**
+     * @brief Set structure receiving statistics of each generation.
+     * @param [in] s Shared pointer to statistics.
+     */
+    void setStats(std::shared_ptr<GEStats> s) { stats = std::move(s); };
+
+    /**
+     * @brief Enable measurement of time of phases, hashed keys and peak
+     * memory of each generation.
+     * @details Measured values are stored to statistics set by
+     * GEDriver::setStats. Disabled by default.
+     * @param [in] enable True to enable measurement.
+     */
+    void setTiming(bool enable) { timing = enable; };
+
+    /**
+     * @brief Enable cost of hash function as second objective.
+     * @details Cost of each individual is estimated by hashCost and whole
+     * generation is ranked by given GEPareto after evaluation. Fitness of
+     * individuals is not changed.
+     * @param [in] p Shared pointer to ranking, nullptr disables it.
+     */
+    void setPareto(std::shared_ptr<GEPareto> p) { pareto = std::move(p); };
+
+    /**
+     * @brief Evaluate all individuals and set their fitness.
+     * @param [in out] individuals Individuals to be evaluated.
+     */
+    void evaluate(gram::Individuals &individuals) override;
+
+    /**
+     * @brief Get number of threads used for evaluation.
+     * @return Number of workers.
+     */
+    size_t threads(void) const { return pool.size(); };
+
+    /**
+     * @brief Default destructor.
+     */
+    ~GEDriver() = default;
+
+  private:
+    /**
+     * @brief Mapper used to map genotypes to phenotypes.
+     */
+    std::unique_ptr<gram::Mapper> mapper;
+
+    /**
+     * @brief Evaluators owned by workers.
+     */
+    std::vector<std::unique_ptr<GEEvaluatorBase>> evaluators;
+
+    /**
+     * @brief Pool of worker threads.
+     */
+    GEThreadPool pool;
+
+    /**
+     * @brief Fitness of already evaluated phenotypes, by cache key.
+     */
+    std::unordered_map<std::string, gram::Fitness> cache;
+
+    /**
+     * @brief Cache keys whose fitness is estimate of staged evaluation.
+     * @details Such fitness is reused, but never contributes to cutoff.
+     */
+    std::unordered_set<std::string> estimated;
+
+    /**
+     * @brief File shared with other runs, nullptr if not used.
+     */
+    std::unique_ptr<GEPersistentCache> persistent;
+
+    /**
+     * @brief Flag if cache key is canonical form of phenotype.
+     */
+    bool canonical = false;
+
+    /**
+     * @brief Magic constant used for canonical form.
+     */
+    uint64_t magic = 0;
+
+    /**
+     * @brief Source of cutoff.
+     */
+    CutoffMode cutoff_mode = CutoffMode::None;
+
+    /**
+     * @brief Cutoff used in Value mode.
+     */
+    gram::Fitness cutoff_value = 0.0;
+
+    /**
+     * @brief Tournament size used in Tournament mode.
+     */
+    unsigned long tournament = 2;
+
+    /**
+     * @brief Stages of evaluation on subsamples.
+     */
+    std::vector<GEStage> stages;
+
+    /**
+     * @brief Fitness of completely evaluated individuals of previous
+     * generation.
+     */
+    std::vector<gram::Fitness> previous;
+
+    /**
+     * @brief Statistics of last generation.
+     */
+    std::shared_ptr<GEStats> stats;
+
+    /**
+     * @brief Flag if phases of evaluation are measured.
+     */
+    bool timing = false;
+
+    /**
+     * @brief Pareto ranking of generations, nullptr if not used.
+     */
+    std::shared_ptr<GEPareto> pareto;
+
+    /**
+     * @brief Estimated cost of already seen phenotypes, by cache key.
+     */
+    std::unordered_map<std::string, double> costs;
+
+    /**
+     * @brief Get cache key of phenotype.
+     * @param [in] phenotype Mapped phenotype.
+     * @return Canonical form of phenotype if enabled, phenotype otherwise.
+     */
+    std::string cacheKey(const gram::Phenotype &phenotype) const;
+
+    /**
+     * @brief Get estimated cost of phenotype, see HashCost::cycles.
+     * @param [in] phenotype Mapped phenotype.
+     * @param [in] key Cache key of phenotype.
+     * @return Cycles per key, infinity if phenotype is not valid.
+     */
+    double phenotypeCost(const gram::Phenotype &phenotype,
+                         const std::string &key);
+
+    /**
+     * @brief Compute cutoff for current generation.
+     * @return Cutoff, infinity if evaluation should not be truncated.
+     */
+    gram::Fitness currentCutoff(void);
+};
@@ -11,7 +11,12 @@
 
 #pragma once
 
+#include "GEDataset.h"
+#include "GEEvaluatorBase.h"
+#include "GEFitnessDetails.h"
+#include "GEThreadPool.h"
 #include "HTable.h"
+#include "HashReducer.h"
 #include <array>
 #include <fstream>
 #include <gram/evaluation/Evaluator.h>
@@ -21,14 +26,37 @@
 #include <iostream>
 #include <limits>
 #include <math.h>
+#include <memory>
+#include <optional>
 #include <vector>
 
 using namespace gram;
 
+/**
+ * @brief Weights of distribution quality metrics added to fitness.
+ * @details Each metric is zero for ideal hash function, fitness is
+ * multiplied by one plus weighted sum of metrics. Zero weights only log the
+ * metrics.
+ */
+struct GEQuality {
+    /// Weight of avalanche bias, RMS deviation of avalanche matrix from 0.5.
+    double avalanche = 0.0;
+    /// Weight of chi-square of table occupancy per degree of freedom above 1.
+    double chi2 = 0.0;
+    /// Weight of maximal load relative to random hash function above 1.
+    double max_load = 0.0;
+    /// Number of sampled keys whose bits are flipped.
+    size_t keys = 128;
+};
+
 /**
  * @brief Class implemeting evaluation mechanism for GEHash.
+ * @details Evaluator is instantiated for table sizes listed in
+ * GEEvaluatorBits, so hash functions are evolved for table of exactly the
+ * size they will be used with.
+ * @tparam Bits Number of bits of hash table index.
  */
-class GEEvaluator : public Evaluator {
+template <unsigned Bits> class GEEvaluator : public GEEvaluatorBase {
 
   public:
     /**
@@ -38,13 +66,93 @@ class GEEvaluator : public Evaluator {
 
     /**
      * @brief Constructor of GEEvaluator class.
+     * @details Training data are loaded into memory once here.
      * @param [in] magic Magic number used in grammar.
      * @param [in] data_path Path to training data file.
      * @param [in] useSum Flag which fitness function to use, if with or without
      * sum.
+     * @param [in] engine Backend used for evaluating hash functions.
+     * @exception datasetError Training data could not be loaded.
      */
     GEEvaluator(uint64_t magic, const std::string &data_path,
-                const bool &useSum);
+                const bool &useSum, HashEngine engine = HashEngine::VM);
+
+    /**
+     * @brief Constructor of GEEvaluator class using already loaded data.
+     * @details Training data are shared, so multiple evaluators (e.g. one
+     * per thread) keep only single copy in memory.
+     * @param [in] magic Magic number used in grammar.
+     * @param [in] dataset Shared pointer to loaded training data.
+     * @param [in] useSum Flag which fitness function to use, if with or without
+     * sum.
+     * @param [in] engine Backend used for evaluating hash functions.
+     */
+    GEEvaluator(uint64_t magic, std::shared_ptr<const GEDataset> dataset,
+                const bool &useSum, HashEngine engine = HashEngine::VM);
+
+    /**
+     * @brief Getter of loaded training data.
+     * @return Reference to training data.
+     */
+    const GEDataset &getDataset(void) const { return *data; };
+
+    /**
+     * @brief Getter of shared pointer to loaded training data.
+     * @return Shared pointer to training data.
+     */
+    std::shared_ptr<const GEDataset> sharedDataset(void) const {
+        return data;
+    };
+
+    /**
+     * @brief Split hashing of training data into shards evaluated in parallel.
+     * @details Training data are divided into chunks which are claimed by
+     * threads of private pool, each thread counting keys per index in its own
+     * histogram. Histograms are summed before fitness is computed. Used only
+     * if hash function is compiled (see HTable::isConcurrent), ChaiScript
+     * backend always runs on single thread.
+     * @param [in] shards Number of threads hashing single phenotype, 1
+     * disables sharding.
+     * @exception geThreadsError Number of shards is out of range.
+     */
+    void setShards(size_t shards);
+
+    /**
+     * @brief Evaluate hash function for multiple table sizes in single pass.
+     * @details Full 64-bit hash value of each key is computed once and
+     * reduced by each of given reductions into its own histogram. Fitness of
+     * each table is divided by expected fitness of uniformly random hash
+     * function for the same table and number of keys, and returned fitness
+     * is sum of these ratios, so tables of different sizes have equal
+     * weight. Fitness of each table is stored to details.
+     * @param [in] reducers Reductions to table indexes, empty list restores
+     * evaluation on single table of 2^Bits indexes.
+     * @param [in] details Shared store of fitness of each table, may be
+     * nullptr.
+     */
+    void setResolutions(std::vector<HashReducer> reducers,
+                        std::shared_ptr<GEFitnessDetails> details);
+
+    /**
+     * @brief Set subsamples of training data for staged evaluation.
+     * @param [in] samples Samples used by GEEvaluator::evaluateStage, in
+     * order of stages.
+     */
+    void setStages(std::vector<std::shared_ptr<const GEDataset>> samples);
+
+    /**
+     * @brief Enable distribution quality metrics.
+     * @details After evaluation on whole training set, avalanche matrix of
+     * raw hash value is computed on sampled keys and chi-square and maximal
+     * load are computed from occupancy of table (first table in
+     * multi-resolution evaluation). Metrics are stored to store as
+     * "avalanche", "chi2" and "max_load" and weighted into fitness, see
+     * GEQuality. Truncated and staged evaluations are not affected.
+     * @param [in] q Weights and number of sampled keys.
+     * @param [in] store Shared store of metrics, may be nullptr.
+     */
+    void setQuality(const GEQuality &q,
+                    std::shared_ptr<GEFitnessDetails> store);
 
     /**
      * @brief Calculate fitness for given program.
@@ -55,6 +163,22 @@ class GEEvaluator : public Evaluator {
      */
     Fitness calculateFitness(std::string program);
 
+    /**
+     * @brief Calculate fitness for given program with early abort.
+     * @details Training data are inserted in blocks of
+     * GEEvaluator::abort_step keys and sum of squared collision counts,
+     * lower bound of both fitness functions, is compared to cutoff after
+     * each block. Cutoff is ignored in multi-resolution evaluation.
+     * @param [in] program Generated string containing program.
+     * @param [in] cutoff Fitness over which evaluation is stopped.
+     * @param [out] truncated Set to true if evaluation was stopped.
+     * @return Calculated fitness, or its estimate if evaluation was stopped.
+     * @exception If there is duplicity in training data throw hashInsertError
+     * exception.
+     */
+    Fitness calculateFitness(const std::string &program, Fitness cutoff,
+                             bool &truncated);
+
     /**
      * @brief Evaluate given phenotype.
      * @param [in out] phenotype Reference to phenotype to be evaluated.
@@ -64,27 +188,225 @@ class GEEvaluator : public Evaluator {
      */
     Fitness evaluate(const Phenotype &phenotype) noexcept override;
 
+    /**
+     * @brief Evaluate given phenotype with early abort.
+     * @param [in] phenotype Phenotype to be evaluated.
+     * @param [in] cutoff Fitness over which evaluation is stopped.
+     * @param [out] truncated Set to true if evaluation was stopped.
+     * @return Calculated fitness. Otherwise set fitness to high number.
+     * @exception No exceptions guarantee.
+     */
+    Fitness evaluateBounded(const Phenotype &phenotype, Fitness cutoff,
+                            bool &truncated) noexcept override;
+
+    /**
+     * @brief Evaluate given phenotype on subsample of training data.
+     * @details Sample is hashed into table of 2^Bits indexes also in
+     * multi-resolution evaluation.
+     * @param [in] phenotype Phenotype to be evaluated.
+     * @param [in] stage Index of sample set by GEEvaluator::setStages.
+     * @return Fitness ratio to random function. Otherwise high number.
+     * @exception No exceptions guarantee.
+     */
+    Fitness evaluateStage(const Phenotype &phenotype,
+                          size_t stage) noexcept override;
+
+    /**
+     * @brief Expected fitness of uniformly random hash function.
+     * @return Expected fitness on whole training data, number of tables in
+     * multi-resolution evaluation.
+     */
+    Fitness randomFitness(void) const override;
+
+    /**
+     * @brief Number of keys hashed by evaluator since its construction.
+     * @return Number of hashed keys.
+     */
+    size_t keysHashed(void) const override { return hashed; };
+
+    /**
+     * @brief Number of keys inserted between cutoff checks.
+     */
+    static constexpr size_t abort_step = 16384;
+
     /**
      * @brief Default destructor.
      */
     ~GEEvaluator() = default;
 
   private:
+    /**
+     * @brief Type of hash table used for evaluation.
+     */
+    using Table = HTable<Bits, GEDataset::Key>;
+
+    /**
+     * @brief Type of array with number of keys mapped to each index.
+     */
+    using Dimensions = typename Table::Dimensions;
+
     /**
      * @brief Instance of HTable used for evaluation of generated phenotype.
      */
-    HTable<uint16_t, std::array<uint32_t, 9>> table;
+    Table table;
 
     /**
-     * @brief Path to training data file.
+     * @brief Training data loaded into memory.
      */
-    std::string d_path;
+    std::shared_ptr<const GEDataset> data;
 
     /**
      * @brief Flag if to use fitness with or without sum.
      */
     bool use_sum;
 
+    /**
+     * @brief Pool of threads hashing shards of training data.
+     */
+    std::unique_ptr<GEThreadPool> shard_pool;
+
+    /**
+     * @brief Private histogram of each shard thread.
+     */
+    std::vector<std::vector<uint32_t>> shard_counts;
+
+    /**
+     * @brief Merged histograms of shard threads.
+     */
+    std::unique_ptr<Dimensions> shard_sum;
+
+    /**
+     * @brief Sum of squared counts greater than 1 of merged histogram.
+     */
+    uint64_t shard_squares = 0;
+
+    /**
+     * @brief Number of keys hashed since construction.
+     */
+    size_t hashed = 0;
+
+    /**
+     * @brief Reductions of hash value for multi-resolution fitness.
+     */
+    std::vector<HashReducer> reducers;
+
+    /**
+     * @brief Expected fitness of random hash function for each reduction.
+     */
+    std::vector<Fitness> baselines;
+
+    /**
+     * @brief Subsamples of training data for staged evaluation.
+     */
+    std::vector<std::shared_ptr<const GEDataset>> samples;
+
+    /**
+     * @brief Expected fitness of random hash function for each sample.
+     */
+    std::vector<Fitness> sample_baselines;
+
+    /**
+     * @brief Histogram of each reduction, for each shard thread.
+     */
+    std::vector<std::vector<Dimensions>> res_counts;
+
+    /**
+     * @brief Store of fitness of each reduction.
+     */
+    std::shared_ptr<GEFitnessDetails> details;
+
+    /**
+     * @brief Weights of quality metrics, if enabled.
+     */
+    std::optional<GEQuality> quality;
+
+    /**
+     * @brief Store of quality metrics.
+     */
+    std::shared_ptr<GEFitnessDetails> quality_details;
+
+    /**
+     * @brief Number of flips of each output bit for each key bit, sized for
+     * 64-bit output.
+     */
+    std::vector<uint32_t> flips;
+
+    /**
+     * @brief Allocate histograms for reductions and shard threads.
+     */
+    void allocateResolutions(void);
+
+    /**
+     * @brief Add weighted quality metrics to fitness.
+     * @details Auxiliary function used in GEEvaluator::calculateFitness.
+     * @param [in] program Evaluated program, used as key in store.
+     * @param [in] arr Occupancy of table.
+     * @param [in] fit Fitness of program.
+     * @return Fitness including quality metrics.
+     */
+    Fitness qualityFitness(const std::string &program, const Dimensions &arr,
+                           Fitness fit);
+
+    /**
+     * @brief Calculate avalanche bias of compiled function.
+     * @details Every bit of each sampled key is flipped and flips of each
+     * bit of raw hash value are counted, before it is folded to table index.
+     * Only low 32 bits are counted if result type of function is 32-bit,
+     * see HTable::outputBits. Keys and their variants are hashed in batches,
+     * so vectorized backends are used.
+     * @return RMS deviation of flip probabilities from 0.5 scaled to range
+     * 0 to 1, with sampling noise of ideal function subtracted.
+     */
+    double avalancheBias(void);
+
+    /**
+     * @brief Calculate multi-resolution fitness of compiled function.
+     * @details Auxiliary function used in GEEvaluator::calculateFitness.
+     * @param [in] program Evaluated program, used as key in details.
+     * @return Sum of fitness ratios of all reductions.
+     */
+    Fitness resolutionFitness(const std::string &program);
+
+    /**
+     * @brief Expected fitness of uniformly random hash function.
+     * @details Number of keys in each index follows Poisson distribution with
+     * mean n/m. Used as baseline of multi-resolution and staged fitness.
+     * @param [in] buckets Number of table indexes.
+     * @param [in] keys Number of hashed keys.
+     * @return Expected value of selected fitness function.
+     */
+    Fitness expectedFitness(size_t buckets, size_t keys) const;
+
+    /**
+     * @brief Calculate fitness of compiled function on given keys.
+     * @details Auxiliary function used in GEEvaluator::evaluateStage.
+     * @param [in] set Keys to be hashed.
+     * @return Fitness on table of 2^Bits indexes.
+     */
+    Fitness sampleFitness(const GEDataset &set);
+
+    /**
+     * @brief Hash training data on multiple threads.
+     * @details Auxiliary function used in GEEvaluator::calculateFitness.
+     * Merged histogram is stored to GEEvaluator::shard_sum and its fitness
+     * without sum to GEEvaluator::shard_squares.
+     * @param [in] set Keys to be hashed.
+     * @param [in] cutoff Fitness over which hashing is stopped.
+     * @param [out] bound Lower bound of fitness if hashing was stopped.
+     * @param [out] processed Number of hashed keys if hashing was stopped.
+     * @return False if hashing was stopped by cutoff.
+     */
+    bool shardedDimensions(const GEDataset &set, Fitness cutoff,
+                           uint64_t &bound, size_t &processed);
+
+    /**
+     * @brief Estimate fitness of truncated evaluation.
+     * @param [in] bound Lower bound of fitness after processed keys.
+     * @param [in] processed Number of inserted keys.
+     * @return Bound extrapolated to whole training data.
+     */
+    Fitness truncatedFitness(uint64_t bound, size_t processed) const;
+
     /**
      * @brief Calculate fitness for given array.
      * @details Auxiliary function used in GEEvaluator::calculateFitness.
@@ -98,35 +420,30 @@ class GEEvaluator : public Evaluator {
      * @param [in out] fit Reference to Fitness variable where will be stored
      * result.
      */
-    void fitnessWithSum(
-        const std::array<uint16_t, numeric_limits<uint16_t>::max()> &arr,
-        Fitness &fit);
+    void fitnessWithSum(const Dimensions &arr, Fitness &fit);
 
     /**
      * @brief Calculate fitness from given array.
-     * @details Auxiliary function used in GEEvaluator::calculateFitness.
+     * @details Auxiliary function used in GEEvaluator::resolutionFitness.
      * Function uses similar formula as GEEvaluator::fitnessWithSum, but fitness
      * is computed as sum of number of keys at each index squared, given that
-     * number of keys is greater than 1.
+     * number of keys is greater than 1. Single table evaluation does not need
+     * it, as the same value is maintained by HTable during insertion (see
+     * HTable::getSquares).
      * @param [in] arr Array representing array dimensions (number of keys
      * mapped on each index).
      * @param [in out] fit Reference to Fitness variable where will be stored
      * result.
      */
-    void fitnessWithoutSum(
-        const std::array<uint16_t, numeric_limits<uint16_t>::max()> &arr,
-        Fitness &fit);
+    void fitnessWithoutSum(const Dimensions &arr, Fitness &fit);
+};
 
-    /**
-     * @brief Private function for spliting strings.
-     * @details Because std::string has no standard function for splitting
-     * strings each project needs to implement its own version. Function used in
-     * this project is from answer found at <a
-     * href="https://stackoverflow.com/a/37454181">StackOverflow</a>.
-     * @param [in] str String to be parsed.
-     * @param [in] delim Delimiter used for splitting given string.
-     * @return Returns vector of strings.
-     */
-    std::vector<std::string> split(const std::string &str,
-                                   const std::string &delim);
-};
\ No newline at end of file
+/**
+ * @brief Numbers of table index bits GEEvaluator is instantiated for.
+ */
+constexpr std::array<unsigned, 4> GEEvaluatorBits = {12, 16, 20, 24};
+
+extern template class GEEvaluator<12>;
+extern template class GEEvaluator<16>;
+extern template class GEEvaluator<20>;
+extern template class GEEvaluator<24>;
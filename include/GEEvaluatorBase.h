@@ -0,0 +1,76 @@
+/**
+ * @file GEEvaluatorBase.h
+ * @author Adam Freiberg (xfreib00@stud.fit.vutbr.cz)
+ * @brief Header file for GEEvaluatorBase interface
+ * @version 0.1
+ * @date 2021-07-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <gram/evaluation/Evaluator.h>
+#include <gram/individual/Fitness.h>
+#include <gram/individual/Phenotype.h>
+
+/**
+ * @brief Interface of GEHash evaluators used by GEDriver.
+ * @details Extends gram::Evaluator with evaluation which may be stopped once
+ * fitness is known to be worse than given cutoff. Implemented by
+ * GEEvaluator for all table sizes.
+ */
+class GEEvaluatorBase : public gram::Evaluator {
+
+  public:
+    /**
+     * @brief Evaluate phenotype with early abort.
+     * @details Fitness is lower-is-better and grows while keys are inserted,
+     * so evaluation stops as soon as its lower bound exceeds cutoff. Fitness
+     * of truncated evaluation is estimate of full fitness, always greater
+     * than cutoff.
+     * @param [in] phenotype Phenotype to be evaluated.
+     * @param [in] cutoff Fitness over which evaluation is stopped, infinity
+     * evaluates whole training set.
+     * @param [out] truncated Set to true if evaluation was stopped.
+     * @return Calculated fitness.
+     */
+    virtual gram::Fitness evaluateBounded(const gram::Phenotype &phenotype,
+                                          gram::Fitness cutoff,
+                                          bool &truncated) noexcept = 0;
+
+    /**
+     * @brief Evaluate phenotype on subsample of training data.
+     * @details Used by GEDriver to discard bad individuals before evaluation
+     * on whole training set. Fitness is divided by expected fitness of
+     * uniformly random hash function on the same sample, so result is about
+     * 1.0 for random-like function regardless of sample size.
+     * @param [in] phenotype Phenotype to be evaluated.
+     * @param [in] stage Index of sample given to evaluator.
+     * @return Fitness ratio to random function, high number on failure.
+     */
+    virtual gram::Fitness evaluateStage(const gram::Phenotype &phenotype,
+                                        size_t stage) noexcept = 0;
+
+    /**
+     * @brief Expected fitness of uniformly random hash function.
+     * @details Scale of ratio returned by GEEvaluatorBase::evaluateStage
+     * relative to fitness on whole training set.
+     * @return Expected fitness on whole training set.
+     */
+    virtual gram::Fitness randomFitness(void) const = 0;
+
+    /**
+     * @brief Number of keys hashed by evaluator since its construction.
+     * @details Used by GEDriver to report hashing throughput.
+     * @return Number of hashed keys.
+     */
+    virtual size_t keysHashed(void) const = 0;
+
+    /**
+     * @brief Default destructor.
+     */
+    virtual ~GEEvaluatorBase() = default;
+};
@@ -11,15 +11,50 @@
 
 #pragma once
 
+#include "GEPerfCounters.h"
+#include "GEStats.h"
+#include <chrono>
 #include <functional>
 #include <memory>
+#include <vector>
 
 #include <gram/evaluation/driver/EvaluationDriver.h>
+#include <gram/operator/selector/comparer/IndividualComparer.h>
 #include <gram/population/Population.h>
 #include <gram/util/logger/Logger.h>
 
 using namespace std;
 
+/**
+ * @brief Parameters of migration between islands of island model.
+ */
+struct GEMigration {
+    /**
+     * @brief Islands receiving migrants from each island.
+     */
+    enum class Topology {
+        /// island i sends migrants to island i + 1
+        Ring,
+        /// every island sends migrants to all other islands
+        Full
+    };
+
+    /**
+     * @brief Topology of migration.
+     */
+    Topology topology = Topology::Ring;
+
+    /**
+     * @brief Number of generations between migrations.
+     */
+    unsigned long interval = 10;
+
+    /**
+     * @brief Number of best individuals sent by each island.
+     */
+    unsigned long migrants = 1;
+};
+
 /**
  * @brief Reimplemented gram::Evolution class.
  * @details This class is reimplementation of gram's Evolution class, because
@@ -62,7 +97,113 @@ class GEEvolution {
                          function<bool(gram::Population &, unsigned long)>
                              terminatingCondition) const;
 
+    /**
+     * @brief Function for executing island model evolution.
+     * @details Islands evolve independently, but all of them are evaluated
+     * together by single call of evaluation driver, so they share its threads
+     * and fitness cache. Every GEMigration::interval generations, copies of
+     * best individuals of each island replace worst individuals of its
+     * neighbours, both ordered by comparer set by GEEvolution::setComparer.
+     * Progress and result of island with best individual are
+     * logged.
+     * @param [in] islands Created populations of islands.
+     * @param [in] gen Parameter used mainly as maximum number of generations.
+     * @param [in] migration Parameters of migration.
+     * @param [in] terminatingCondition Std::function returning bool value,
+     * evolution stops when it is met by any island.
+     * @return Returns final population of island with best individual.
+     */
+    gram::Population
+    run(std::vector<gram::Population> islands, unsigned long gen,
+        const GEMigration &migration,
+        function<bool(gram::Population &, unsigned long)>
+            terminatingCondition) const;
+
+    /**
+     * @brief Set statistics receiving time of reproduction and logging.
+     * @details Time is measured only when statistics are timed by
+     * evaluation driver, see GEDriver::setTiming. Total time of generation
+     * then includes all phases.
+     * @param [in] s Shared pointer to statistics filled by evaluation
+     * driver.
+     */
+    void setStats(std::shared_ptr<GEStats> s) { stats = std::move(s); };
+
+    /**
+     * @brief Set hardware counters measuring reproduction and evaluation.
+     * @details Counts of each generation and totals of run are stored to
+     * statistics given to GEEvolution::setStats. Counters must be opened
+     * before threads of evaluation driver are created, see GEPerfCounters.
+     * @param [in] c Shared pointer to opened counters.
+     */
+    void setCounters(std::shared_ptr<GEPerfCounters> c) {
+        counters = std::move(c);
+    };
+
+    /**
+     * @brief Set comparer choosing migrants and individuals they replace.
+     * @details Should be the same comparer as used by selection, e.g.
+     * GEParetoComparer in multi-objective evolution. Individuals are
+     * compared by fitness if no comparer is set.
+     * @param [in] c Shared pointer to comparer.
+     */
+    void setComparer(std::shared_ptr<const gram::IndividualComparer> c) {
+        comparer = std::move(c);
+    };
+
   private:
+    /// Clock used for timing of phases.
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Store time of phases of generation to statistics.
+     * @param [in] start Start of generation, before logging of previous one.
+     * @param [in] logged End of logging.
+     * @param [in] reproduced End of reproduction.
+     */
+    void recordTime(Clock::time_point start, Clock::time_point logged,
+                    Clock::time_point reproduced) const;
+
+    /**
+     * @brief Read hardware counters, if set.
+     * @return Current counts, empty if not counted.
+     */
+    GEPerfCounts count(void) const;
+
+    /**
+     * @brief Store hardware counts of generation to statistics.
+     * @param [in] start Counts before reproduction.
+     * @param [in] reproduced Counts after reproduction, before evaluation.
+     * @param [in out] total Counts of run, generation is added to them.
+     */
+    void recordCounts(const GEPerfCounts &start,
+                      const GEPerfCounts &reproduced,
+                      GEPerfCounts &total) const;
+
+    /**
+     * @brief Evaluate individuals of all islands at once.
+     * @param [in out] islands Populations of islands.
+     */
+    void evaluate(std::vector<gram::Population> &islands) const;
+
+    /**
+     * @brief Replace worst individuals of islands by best individuals of
+     * their neighbours.
+     * @param [in out] islands Populations of islands.
+     * @param [in] migration Parameters of migration.
+     */
+    void migrate(std::vector<gram::Population> &islands,
+                 const GEMigration &migration) const;
+
+    /**
+     * @brief Check if first individual is better for migration.
+     * @param [in] a First individual.
+     * @param [in] b Second individual.
+     * @return Result of comparer, or comparison of fitness if it is not set.
+     */
+    bool isFirstBetter(const gram::Individual &a,
+                       const gram::Individual &b) const;
+
     /**
      * @brief Unique pointer to EvaulationDriver object specified in class
      * constructor.
@@ -73,4 +214,19 @@ class GEEvolution {
      * @brief Unique pointer to Logger object specified in class constructor.
      */
     std::unique_ptr<gram::Logger> logger;
+
+    /**
+     * @brief Statistics of last generation, if set.
+     */
+    std::shared_ptr<GEStats> stats;
+
+    /**
+     * @brief Comparer used for migration, if set.
+     */
+    std::shared_ptr<const gram::IndividualComparer> comparer;
+
+    /**
+     * @brief Hardware performance counters, if set.
+     */
+    std::shared_ptr<GEPerfCounters> counters;
 };
\ No newline at end of file
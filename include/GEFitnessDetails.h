@@ -0,0 +1,103 @@
+/**
+ * @file GEFitnessDetails.h
+ * @author Adam Freiberg (xfreib00@stud.fit.vutbr.cz)
+ * @brief Header file for GEFitnessDetails class
+ * @version 0.1
+ * @date 2021-07-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <gram/individual/Fitness.h>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Partial fitness values of evaluated phenotypes.
+ * @details Individual carries only single fitness value used for selection.
+ * When fitness is combined from multiple parts (e.g. multiple table sizes),
+ * evaluators store the parts here and GELogger reads them for logged
+ * individuals. Store is shared by all evaluation threads.
+ */
+class GEFitnessDetails {
+
+  public:
+    /**
+     * @brief Constructor of GEFitnessDetails class.
+     * @param [in] names Names of fitness parts, in order of stored values.
+     */
+    explicit GEFitnessDetails(std::vector<std::string> names);
+
+    /**
+     * @brief Identify phenotypes by canonical form.
+     * @details Must match key of fitness cache (see GEDriver::setCanonical),
+     * so parts are found also for phenotypes whose fitness was taken from
+     * cache.
+     * @param [in] magic Value of magic constant.
+     */
+    void setCanonical(uint64_t magic) {
+        canonical = true;
+        this->magic = magic;
+    };
+
+    /**
+     * @brief Store fitness parts of phenotype.
+     * @param [in] phenotype Evaluated phenotype.
+     * @param [in] values Fitness parts, one for each name.
+     */
+    void store(const std::string &phenotype, std::vector<gram::Fitness> values);
+
+    /**
+     * @brief Find fitness parts of phenotype.
+     * @param [in] phenotype Evaluated phenotype.
+     * @param [out] values Stored fitness parts.
+     * @return True if phenotype was found.
+     */
+    bool find(const std::string &phenotype,
+              std::vector<gram::Fitness> &values) const;
+
+    /**
+     * @brief Get names of fitness parts.
+     * @return Names in order of stored values.
+     */
+    const std::vector<std::string> &names(void) const { return part_names; };
+
+  private:
+    /**
+     * @brief Names of fitness parts.
+     */
+    std::vector<std::string> part_names;
+
+    /**
+     * @brief Fitness parts of each evaluated phenotype.
+     */
+    std::unordered_map<std::string, std::vector<gram::Fitness>> values;
+
+    /**
+     * @brief Flag if phenotypes are identified by canonical form.
+     */
+    bool canonical = false;
+
+    /**
+     * @brief Magic constant used for canonical form.
+     */
+    uint64_t magic = 0;
+
+    /**
+     * @brief Get key of phenotype.
+     * @param [in] phenotype Evaluated phenotype.
+     * @return Canonical form of phenotype if enabled, phenotype otherwise.
+     */
+    std::string key(const std::string &phenotype) const;
+
+    /**
+     * @brief Mutex guarding stored values.
+     */
+    mutable std::mutex mtx;
+};
@@ -13,8 +13,6 @@
 
 /* include gram headers */
 
-#include <gram/evaluation/EvaluatorCache.h>
-#include <gram/evaluation/driver/SingleThreadDriver.h>
 #include <gram/language/mapper/ContextFreeMapper.h>
 #include <gram/language/parser/BnfRuleParser.h>
 #include <gram/operator/crossover/OnePointCrossover.h>
@@ -28,11 +26,18 @@
 #include <gram/random/number_generator/StdNumberGenerator.h>
 
 /* standard libraries and user defined dependencies */
+#include "GEDriver.h"
 #include "GEEvaluator.h"
 #include "GEEvolution.h"
 #include "GELogger.h"
+#include "GEPareto.h"
+#include "GEPerfCounters.h"
+#include "GERandom.h"
+#include "HashExport.h"
 #include "error/geError.h"
 #include <functional>
+#include <iostream>
+#include <optional>
 #include <random>
 #include <stdexcept>
 
@@ -62,8 +67,12 @@ class GEHash {
      * @param [in out] outpath Path to output file used by Logger class.
      * @param [in] debug Use debugging in logger, that additionaly outputs
      * phenotype. Defaluts to false.
+     * @param [in] stream Write one JSON line per generation during run
+     * instead of JSON array at the end, see GELogger::setStreaming.
+     * Defaults to false.
      */
-    void SetLogger(const std::string &outpath, bool debug = false);
+    void SetLogger(const std::string &outpath, bool debug = false,
+                   bool stream = false);
 
     /**
      * @brief Setter for grammar parser.
@@ -73,15 +82,183 @@ class GEHash {
      */
     void SetGrammar(std::string &grammar, unsigned long limit);
 
+    /**
+     * @brief Set number of threads used for evaluation.
+     * @details Must be called before GEHash::SetEvaluator. Individuals are
+     * evaluated on given number of threads and each of them hashes training
+     * data on given number of shard threads, so threads * shards threads are
+     * used in total.
+     * @param [in] threads Number of individuals evaluated in parallel.
+     * @param [in] shards Number of threads evaluating single individual.
+     * Defaults to 1.
+     * @exception geThreadsError Number of threads is out of range.
+     */
+    void SetThreads(unsigned long threads, unsigned long shards = 1);
+
+    /**
+     * @brief Evaluate hash functions for multiple table sizes at once.
+     * @details Must be called before GEHash::SetEvaluator. See
+     * GEEvaluator::setResolutions and HashReducer::parseList.
+     * @param [in] spec Comma separated list of reductions, e.g.
+     * "fold:12,fold:16,prime:65521". Empty string disables multi-resolution
+     * evaluation.
+     * @exception hashReducerError Invalid list of reductions.
+     */
+    void SetResolutions(const std::string &spec);
+
     /**
      * @brief Setter for evaluation driver.
+     * @details Creates evaluator for each thread set by GEHash::SetThreads,
+     * all of them sharing single copy of training data.
      * @param [in] magic Magic number used in grammar.
      * @param [in] data_path Path to training data file.
      * @param [in] useSum Flag which fitness function to use, if with or without
      * sum.
+     * @param [in] engine Backend used for evaluating hash functions.
+     * @param [in] bits Number of bits of hash table index, see
+     * GEEvaluatorBits. Defaults to 16.
+     * @exception datasetError Training data could not be loaded.
+     * @exception geBitsError Unsupported table size.
      */
     void SetEvaluator(unsigned long magic, const std::string &data_path,
-                      const bool &useSum);
+                      const bool &useSum, HashEngine engine = HashEngine::VM,
+                      unsigned bits = 16);
+
+    /**
+     * @brief Setter for evaluation driver using already loaded data.
+     * @details Training data can be shared by multiple GEHash objects
+     * running concurrently. See GEHash::SetEvaluator.
+     * @param [in] magic Magic number used in grammar.
+     * @param [in] data Shared pointer to loaded training data.
+     * @param [in] useSum Flag which fitness function to use, if with or without
+     * sum.
+     * @param [in] engine Backend used for evaluating hash functions.
+     * @param [in] bits Number of bits of hash table index, see
+     * GEEvaluatorBits. Defaults to 16.
+     * @exception geBitsError Unsupported table size.
+     */
+    void SetEvaluator(unsigned long magic,
+                      std::shared_ptr<const GEDataset> data,
+                      const bool &useSum, HashEngine engine = HashEngine::VM,
+                      unsigned bits = 16);
+
+    /**
+     * @brief Load training data and report their statistics.
+     * @param [in] data_path Path to training data file.
+     * @return Shared pointer to loaded training data.
+     * @exception datasetError Training data could not be loaded.
+     */
+    static std::shared_ptr<const GEDataset>
+    LoadDataset(const std::string &data_path);
+
+    /**
+     * @brief Set seed of random number generators.
+     * @details Each generator used by evolution is seeded by value derived
+     * from seed (see splitmix64), so run can be reproduced. Without seed,
+     * generators are seeded by gram defaults.
+     * @param [in] seed Seed of run.
+     */
+    void SetSeed(uint64_t seed);
+
+    /**
+     * @brief Set distribution quality metrics of hash function.
+     * @details Must be called before GEHash::SetEvaluator. Avalanche bias,
+     * chi-square of table occupancy and maximal load are computed for each
+     * evaluated function and logged under "quality", see
+     * GEEvaluator::setQuality.
+     * @param [in] spec AVALANCHE:CHI2:MAX_LOAD[:KEYS] weights of metrics in
+     * fitness and number of sampled keys, "log" to only log metrics, empty
+     * string disables them.
+     * @exception geQualityError Invalid specification.
+     */
+    void SetQuality(const std::string &spec);
+
+    /**
+     * @brief Set stages of evaluation on subsamples of training data.
+     * @details Must be called before GEHash::SetEvaluator. See
+     * GEDriver::setStages.
+     * @param [in] spec Comma separated list of stages "FRACTION:THRESHOLD",
+     * e.g. "0.01:4,0.1:2", where fraction is part of training data (0 to 1)
+     * and threshold is maximal ratio of fitness to fitness of random hash
+     * function needed for promotion. Empty string disables stages.
+     * @exception geStagesError Invalid list.
+     */
+    void SetStages(const std::string &spec);
+
+    /**
+     * @brief Set island model of evolution.
+     * @details Each island is population of size given to constructor, see
+     * GEEvolution::run.
+     * @param [in] islands Number of islands, 1 disables island model.
+     * @param [in] migration Migration written as "TOPOLOGY:INTERVAL:MIGRANTS",
+     * e.g. "ring:10:2", where topology is "ring" or "full", interval is
+     * number of generations between migrations and migrants is number of
+     * best individuals sent by each island.
+     * @exception geIslandsError Invalid number of islands or migration.
+     */
+    void SetIslands(unsigned long islands, const std::string &migration);
+
+    /**
+     * @brief Export best hash function after evolution.
+     * @details Creates PREFIX.hpp (constexpr C++), PREFIX.h (C) and
+     * PREFIX_bench.cpp (benchmark against common hash functions on training
+     * data), see HashExporter. Index functions are exported for table size
+     * given to GEHash::SetEvaluator, or for each resolution if set.
+     * @param [in] prefix Path and name of created files without extension,
+     * empty string disables export.
+     */
+    void SetExport(const std::string &prefix);
+
+    /**
+     * @brief Enable timing of phases of each generation.
+     * @details Time of mapping, fitness stages, evaluation, reproduction and
+     * logging, number of hashed keys and peak resident set size are logged
+     * with statistics of each generation. Disabled timing does not read
+     * clock at all.
+     * @param [in] timing True to enable timing.
+     */
+    void SetTiming(bool timing);
+
+    /**
+     * @brief Enable hardware performance counters.
+     * @details Must be called before GEHash::SetEvaluator. Cycles,
+     * instructions, LLC misses and branch misses of reproduction and
+     * evaluation are logged with statistics of each generation, totals of
+     * run with result. Counting is disabled with warning if counters are
+     * not available, see GEPerfCounters.
+     * @param [in] counting True to enable counters.
+     */
+    void SetCounters(bool counting);
+
+    /**
+     * @brief Minimize cost of hash function as second objective.
+     * @details Estimated cycles per key (see hashCost) is minimized
+     * together with fitness. Tournament selection compares individuals by
+     * NSGA-II rank and crowding distance instead of fitness, see GEPareto,
+     * and non-dominated front of run is logged with result.
+     * @param [in] pareto True to enable multi-objective evolution.
+     */
+    void SetPareto(bool pareto);
+
+    /**
+     * @brief Set file of fitness cache shared by multiple runs.
+     * @details Must be called before GEHash::SetEvaluator. Entries are
+     * bound to training data, table size, resolutions, fitness function and
+     * magic constant, see GEPersistentCache.
+     * @param [in] path Path to cache file, empty string disables it.
+     */
+    void SetCache(const std::string &path);
+
+    /**
+     * @brief Set cutoff for early abort of evaluation.
+     * @details Evaluation of individual is stopped once its fitness is
+     * known to exceed cutoff, see GEDriver::setCutoff.
+     * @param [in] cutoff "none", "worst" (worst individual of previous
+     * generation), "tournament" (individual of previous generation with less
+     * than 1% chance to win tournament) or non-negative fitness value.
+     * @exception geCutoffError Invalid cutoff.
+     */
+    void SetCutoff(const std::string &cutoff);
 
     /**
      * @brief Set the tournament size
@@ -110,6 +287,13 @@ class GEHash {
     ~GEHash() = default;
 
   private:
+    /**
+     * @brief Write best hash function of final population to files set by
+     * GEHash::SetExport.
+     * @param [in] last_gen Final population.
+     */
+    void Export(Population &last_gen);
+
     /**
      * @brief Number of individuals in population.
      */
@@ -119,6 +303,121 @@ class GEHash {
      */
     unsigned long g;
 
+    /**
+     * @brief Number of threads used for evaluation.
+     */
+    unsigned long threads = 1;
+
+    /**
+     * @brief Number of threads hashing training data of single individual.
+     */
+    unsigned long shards = 1;
+
+    /**
+     * @brief Reductions used for multi-resolution evaluation.
+     */
+    std::vector<HashReducer> reducers;
+
+    /**
+     * @brief Fitness of each reduction, shared by evaluators and logger.
+     */
+    std::shared_ptr<GEFitnessDetails> details;
+
+    /**
+     * @brief Number of islands of island model.
+     */
+    unsigned long islands = 1;
+
+    /**
+     * @brief Migration between islands.
+     */
+    GEMigration migration;
+
+    /**
+     * @brief Prefix of files with exported hash function.
+     */
+    std::string export_prefix;
+
+    /**
+     * @brief Timing of phases of generations.
+     */
+    bool timing = false;
+
+    /**
+     * @brief Counting of hardware events requested.
+     */
+    bool counting = false;
+
+    /**
+     * @brief Multi-objective evolution with cost objective.
+     */
+    bool pareto = false;
+
+    /**
+     * @brief Hardware performance counters, if available and requested.
+     */
+    std::shared_ptr<GEPerfCounters> counters;
+
+    /**
+     * @brief Statistics of last generation shared with driver and logger.
+     */
+    std::shared_ptr<GEStats> stats;
+
+    /**
+     * @brief Source of grammar, parsed again for export.
+     */
+    std::string grammar_src;
+
+    /**
+     * @brief Wrapping limit of mappers.
+     */
+    unsigned long wrap_limit = 0;
+
+    /**
+     * @brief Magic number used in grammar.
+     */
+    uint64_t magic = 0;
+
+    /**
+     * @brief Number of bits of hash table index.
+     */
+    unsigned bits = 16;
+
+    /**
+     * @brief Path to training data.
+     */
+    std::string data_path;
+
+    /**
+     * @brief Seed of random number generators, if set.
+     */
+    std::optional<uint64_t> seed;
+
+    /**
+     * @brief Weights of quality metrics, if enabled.
+     */
+    std::optional<GEQuality> quality;
+
+    /**
+     * @brief Path to persistent fitness cache.
+     */
+    std::string cache_path;
+
+    /**
+     * @brief Stages of evaluation on subsamples of training data.
+     */
+    std::vector<GEStage> stages;
+
+    /**
+     * @brief Source of cutoff for early abort of evaluation.
+     */
+    CutoffMode cutoff_mode = CutoffMode::None;
+
+    /**
+     * @brief Cutoff value used with CutoffMode::Value.
+     */
+    double cutoff_value = 0.0;
+
     /**
      * @brief Tournament size.
      *
@@ -157,17 +456,7 @@ class GEHash {
     std::unique_ptr<ContextFreeMapper> cfmLogger;
 
     /**
-     * @brief Unique pointer to GEEvaluator object.
-     */
-    std::unique_ptr<GEEvaluator> eval;
-
-    /**
-     * @brief Unique pointer to gram::EvaluatorCache object.
-     */
-    std::unique_ptr<EvaluatorCache> cache;
-
-    /**
-     * @brief Unique pointer to gram::SingleThreadDriver object.
+     * @brief Unique pointer to GEDriver object.
      */
-    std::unique_ptr<SingleThreadDriver> driver;
+    std::unique_ptr<GEDriver> driver;
 };
\ No newline at end of file
@@ -11,7 +11,13 @@
 
 #pragma once
 
+#include "GEFitnessDetails.h"
+#include "GEPareto.h"
+#include "GESpscQueue.h"
+#include "GEStats.h"
 #include "error/loggerError.h"
+#include <atomic>
+#include <chrono>
 #include <fstream>
 #include <gram/language/mapper/ContextFreeMapper.h>
 #include <gram/population/Population.h>
@@ -19,13 +25,22 @@
 #include <iomanip>
 #include <iostream>
 #include <nlohmann/json.hpp>
+#include <optional>
 #include <stdexcept>
+#include <thread>
+#include <vector>
 
 using namespace gram;
 using namespace std;
 
 /**
  * @brief Logger class for GEHash grammatical evolution.
+ * @details Evolution thread only copies generation number, best fitness,
+ * statistics and, if phenotype is needed, genotype of best individual, and
+ * passes the copy through GESpscQueue to background thread. Mapping of
+ * genotype, building of JSON objects and output are done there, so logging
+ * does not slow down evolution even in debug mode. Output is complete when
+ * GELogger::logResult returns.
  */
 class GELogger : public Logger {
 
@@ -58,6 +73,14 @@ class GELogger : public Logger {
      */
     void logResult(const Population &population);
 
+    /**
+     * @brief Start background thread if it is not running.
+     * @details Thread is otherwise started by first logged generation. Start
+     * it explicitly before opening performance counters which count threads
+     * created later, so that logging is not counted.
+     */
+    void start(void);
+
     /**
      * @brief Getter of debug flag.
      * @return Current value of debug flag.
@@ -70,12 +93,124 @@ class GELogger : public Logger {
      */
     void setDebug(bool val);
 
+    /**
+     * @brief Enable streaming output.
+     * @details Instead of collecting all generations into JSON array written
+     * at the end of run, each generation is appended to output file as
+     * single compact line (NDJSON). File is buffered and flushed at least
+     * every GELogger::flush_interval seconds and after final result, so
+     * memory use does not grow with number of generations, log of
+     * interrupted run is kept and file can be followed while run is in
+     * progress. Must be called before first generation is logged.
+     * @param [in] val True for NDJSON, false for JSON array (default).
+     */
+    void setStreaming(bool val);
+
+    /**
+     * @brief Interval of flushing streamed output in seconds.
+     */
+    static constexpr double flush_interval = 1.0;
+
+    /**
+     * @brief Set seed of run written to final result.
+     * @param [in] s Seed given to GEHash::SetSeed.
+     */
+    void setSeed(uint64_t s);
+
+    /**
+     * @brief Set store of partial fitness values.
+     * @details Partial fitness values of logged individual are written to
+     * output under "resolutions" key.
+     * @param [in] d Shared pointer to store filled by evaluators.
+     */
+    void setDetails(shared_ptr<GEFitnessDetails> d);
+
+    /**
+     * @brief Set store of quality metrics.
+     * @details Quality metrics of logged individual are written to output
+     * under "quality" key.
+     * @param [in] q Shared pointer to store filled by evaluators.
+     */
+    void setQuality(shared_ptr<GEFitnessDetails> q);
+
+    /**
+     * @brief Set statistics of evaluation.
+     * @details Statistics of each generation are written to output under
+     * "stats" key.
+     * @param [in] s Shared pointer to statistics filled by GEDriver.
+     */
+    void setStats(shared_ptr<GEStats> s);
+
+    /**
+     * @brief Set Pareto ranking of multi-objective evolution.
+     * @details Non-dominated front of run is written to final result under
+     * "front" key.
+     * @param [in] p Shared pointer to ranking filled by GEDriver.
+     */
+    void setPareto(shared_ptr<const GEPareto> p);
+
     /**
      * @brief Logger class destructor.
      */
     ~GELogger();
 
   private:
+    /**
+     * @brief State of single generation passed to background thread.
+     */
+    struct Snapshot {
+        /// True for final result.
+        bool final = false;
+        /// Generation number.
+        unsigned long gen = 0;
+        /// Fitness of best individual.
+        Fitness fitness = 0.0;
+        /// Genotype of best individual, if its phenotype is logged.
+        optional<Genotype> genotype;
+        /// Statistics of generation, if set.
+        optional<GEStats> stats;
+        /// Non-dominated front of run, in final result.
+        vector<GEFrontMember> front;
+    };
+
+    /**
+     * @brief Queue of snapshots waiting for background thread.
+     */
+    GESpscQueue<Snapshot> queue;
+
+    /**
+     * @brief Background thread writing output.
+     */
+    thread worker;
+
+    /**
+     * @brief Flag telling background thread to finish after queue is empty.
+     */
+    atomic<bool> stopping{false};
+
+    /**
+     * @brief Copy state of generation and pass it to background thread.
+     * @param [in] population Logged population.
+     * @param [in] final True for final result.
+     */
+    void enqueue(const Population &population, bool final);
+
+    /**
+     * @brief Main loop of background thread.
+     */
+    void consume(void);
+
+    /**
+     * @brief Build JSON object of generation and write it.
+     * @param [in] s Snapshot of generation.
+     */
+    void process(const Snapshot &s);
+
+    /**
+     * @brief Stop background thread after all snapshots are processed.
+     */
+    void stop(void);
+
     /**
      * @brief Fstream variable for Logger output file.
      */
@@ -91,6 +226,75 @@ class GELogger : public Logger {
      */
     unique_ptr<ContextFreeMapper> mapper;
 
+    /**
+     * @brief Partial fitness values of evaluated phenotypes.
+     */
+    shared_ptr<GEFitnessDetails> details;
+
+    /**
+     * @brief Quality metrics of evaluated phenotypes.
+     */
+    shared_ptr<GEFitnessDetails> quality;
+
+    /**
+     * @brief Statistics of evaluation of last generation.
+     */
+    shared_ptr<GEStats> stats;
+
+    /**
+     * @brief Pareto ranking, if used.
+     */
+    shared_ptr<const GEPareto> pareto;
+
+    /**
+     * @brief Seed of run, if set.
+     */
+    optional<uint64_t> seed;
+
+    /**
+     * @brief Flag if output is streamed as NDJSON.
+     */
+    bool streaming = false;
+
+    /**
+     * @brief Buffer of streamed output file.
+     */
+    vector<char> buffer;
+
+    /**
+     * @brief Time of last flush of streamed output.
+     */
+    chrono::steady_clock::time_point last_flush;
+
+    /**
+     * @brief Store or stream JSON object of single generation.
+     * @param [in] j JSON object of logged generation.
+     * @param [in] final True for final result, output is written or flushed.
+     */
+    void write(const json &j, bool final);
+
+    /**
+     * @brief Add statistics of generation to JSON object.
+     * @param [in out] j JSON object of logged generation.
+     * @param [in] st Statistics of generation.
+     */
+    void logStats(json &j, const GEStats &st) const;
+
+    /**
+     * @brief Create JSON object of hardware counters.
+     * @param [in] c Counted values, only valid ones are written together
+     * with instructions per cycle.
+     * @return JSON object of counters.
+     */
+    static json logCounts(const GEPerfCounts &c);
+
+    /**
+     * @brief Add partial fitness values of individual to JSON object.
+     * @param [in out] j JSON object of logged generation.
+     * @param [in] phenotype Phenotype of logged individual.
+     */
+    void logDetails(json &j, const string &phenotype) const;
+
     /**
      * @brief Debug flag.
      * @details This flag is used to enable mapping genotype to phenotype in
@@ -0,0 +1,164 @@
+/**
+ * @file GEPareto.h
+ * @author Adam Freiberg (xfreib00@stud.fit.vutbr.cz)
+ * @brief Header file for GEPareto and GEParetoComparer classes
+ * @version 0.1
+ * @date 2021-07-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <gram/individual/Individual.h>
+#include <gram/operator/selector/comparer/IndividualComparer.h>
+
+/**
+ * @brief Objectives of individual, both are minimized.
+ */
+struct GEObjectives {
+    /**
+     * @brief Fitness given by evaluation on training data.
+     */
+    gram::Fitness fitness;
+
+    /**
+     * @brief Estimated cycles per key, see hashCost.
+     */
+    double cost;
+
+    /**
+     * @brief Check Pareto dominance.
+     * @param [in] o Other objectives.
+     * @return True if these objectives are not worse in any and better in
+     * at least one objective.
+     */
+    bool dominates(const GEObjectives &o) const {
+        return fitness <= o.fitness && cost <= o.cost &&
+               (fitness < o.fitness || cost < o.cost);
+    };
+};
+
+/**
+ * @brief Member of Pareto front.
+ */
+struct GEFrontMember {
+    /// Genotype of individual.
+    gram::Genotype genotype;
+    /// Objectives of individual.
+    GEObjectives objectives;
+};
+
+/**
+ * @brief Pareto ranking of generations for multi-objective evolution.
+ * @details Each evaluated generation is sorted into non-dominated fronts
+ * and crowding distance is computed within each front as in NSGA-II. Ranks
+ * are stored by genotype, so GEParetoComparer finds them for individuals of
+ * any island. Non-dominated individuals of all generations are kept in
+ * archive, which is logged as result of run.
+ */
+class GEPareto {
+
+  public:
+    /**
+     * @brief Rank evaluated generation and update archive.
+     * @details All individuals are ranked, but only those with exact fitness
+     * are added to archive. Fitness extrapolated by early abort or estimated
+     * by staged evaluation is not.
+     * @param [in] individuals Evaluated individuals.
+     * @param [in] costs Cost of each individual.
+     * @param [in] exact Flag of each individual if its fitness is exact.
+     */
+    void rank(const gram::Individuals &individuals,
+              const std::vector<double> &costs,
+              const std::vector<char> &exact);
+
+    /**
+     * @brief Crowded comparison of NSGA-II.
+     * @param [in] a First individual.
+     * @param [in] b Second individual.
+     * @return True if first individual is in better front, or in the same
+     * front with larger crowding distance. Individuals of unranked
+     * generation are compared by fitness.
+     */
+    bool isFirstBetter(const gram::Individual &a,
+                       const gram::Individual &b) const;
+
+    /**
+     * @brief Get non-dominated individuals found so far.
+     * @return Members of front ordered by fitness.
+     */
+    const std::vector<GEFrontMember> &front(void) const { return archive; };
+
+  private:
+    /**
+     * @brief Rank of individual within generation.
+     */
+    struct Rank {
+        /// Index of front, 0 is non-dominated.
+        size_t front;
+        /// Crowding distance within front.
+        double crowding;
+    };
+
+    /**
+     * @brief Hash of genotype.
+     */
+    struct GenotypeHash {
+        size_t operator()(const gram::Genotype &g) const;
+    };
+
+    /**
+     * @brief Add non-dominated individual to archive.
+     * @param [in] member Candidate member.
+     */
+    void archiveMember(GEFrontMember member);
+
+    /**
+     * @brief Ranks of last generation.
+     */
+    std::unordered_map<gram::Genotype, Rank, GenotypeHash> ranks;
+
+    /**
+     * @brief Non-dominated individuals of all generations.
+     */
+    std::vector<GEFrontMember> archive;
+};
+
+/**
+ * @brief Comparer selecting by Pareto rank in place of
+ * gram::LowFitnessComparer.
+ */
+class GEParetoComparer : public gram::IndividualComparer {
+
+  public:
+    /**
+     * @brief Constructor of GEParetoComparer class.
+     * @param [in] pareto Ranking shared with evaluation driver.
+     */
+    explicit GEParetoComparer(std::shared_ptr<const GEPareto> pareto)
+        : pareto(std::move(pareto)){};
+
+    /**
+     * @brief Compare individuals, see GEPareto::isFirstBetter.
+     * @param [in] a First individual.
+     * @param [in] b Second individual.
+     * @return True if first individual is better.
+     */
+    bool isFirstBetter(const gram::Individual &a,
+                       const gram::Individual &b) const override {
+        return pareto->isFirstBetter(a, b);
+    };
+
+  private:
+    /**
+     * @brief Ranking of current generation.
+     */
+    std::shared_ptr<const GEPareto> pareto;
+};
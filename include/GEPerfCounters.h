@@ -0,0 +1,121 @@
+/**
+ * @file GEPerfCounters.h
+ * @author Adam Freiberg (xfreib00@stud.fit.vutbr.cz)
+ * @brief Header file for GEPerfCounters class
+ * @version 0.1
+ * @date 2021-07-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Values of hardware performance counters.
+ */
+struct GEPerfCounts {
+
+    /**
+     * @brief Counted hardware events.
+     */
+    enum Event : size_t {
+        Cycles,
+        Instructions,
+        LLCMisses,
+        BranchMisses,
+        Events
+    };
+
+    /**
+     * @brief Get name of event used in log.
+     * @param [in] e Event.
+     * @return Name of event.
+     */
+    static const char *name(Event e);
+
+    /**
+     * @brief Check whether event was counted.
+     * @param [in] e Event.
+     * @return True if value of event is valid.
+     */
+    bool has(Event e) const { return (mask >> e) & 1U; };
+
+    /**
+     * @brief Add values of other counts.
+     * @param [in] o Added counts.
+     * @return Reference to this object.
+     */
+    GEPerfCounts &operator+=(const GEPerfCounts &o);
+
+    /**
+     * @brief Difference of counts, e.g. values counted during phase.
+     * @param [in] o Counts read at start of phase.
+     * @return Counts between both readings.
+     */
+    GEPerfCounts operator-(const GEPerfCounts &o) const;
+
+    /**
+     * @brief Value of each event.
+     */
+    std::array<uint64_t, Events> value{};
+
+    /**
+     * @brief Bit e is set if event e was counted.
+     */
+    unsigned mask = 0;
+};
+
+/**
+ * @brief Hardware performance counters of current thread.
+ * @details Counters are opened by perf_event_open for user space only and
+ * count calling thread together with all threads it creates later, such as
+ * evaluation thread pools. Each event is opened separately, so only events
+ * unsupported by CPU or hypervisor are missing. If perf events are not
+ * available at all (containers, perf_event_paranoid), no counter is opened
+ * and GEPerfCounters::available returns false.
+ */
+class GEPerfCounters {
+
+  public:
+    /**
+     * @brief Constructor opening and starting counters.
+     */
+    GEPerfCounters();
+
+    GEPerfCounters(const GEPerfCounters &) = delete;
+    GEPerfCounters &operator=(const GEPerfCounters &) = delete;
+
+    /**
+     * @brief Check whether any counter is open.
+     * @return True if at least one event is counted.
+     */
+    bool available(void) const { return mask != 0; };
+
+    /**
+     * @brief Read current values of counters.
+     * @details Values are scaled when kernel multiplexes counters.
+     * @return Values counted since construction.
+     */
+    GEPerfCounts read(void) const;
+
+    /**
+     * @brief Destructor closing counters.
+     */
+    ~GEPerfCounters();
+
+  private:
+    /**
+     * @brief File descriptor of each event, -1 if not available.
+     */
+    std::array<int, GEPerfCounts::Events> fds;
+
+    /**
+     * @brief Bit e is set if event e is counted.
+     */
+    unsigned mask = 0;
+};
@@ -0,0 +1,110 @@
+/**
+ * @file GEPersistentCache.h
+ * @author Adam Freiberg (xfreib00@stud.fit.vutbr.cz)
+ * @brief Header file for GEPersistentCache class
+ * @version 0.1
+ * @date 2021-07-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include "error/cacheError.h"
+#include <cstdint>
+#include <gram/individual/Fitness.h>
+#include <string>
+#include <sys/types.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Fitness cache stored in file and shared by multiple runs.
+ * @details File is append-only log of text lines
+ * "CONFIG\tFITNESS\tLENGTH\tKEY", where CONFIG identifies training data,
+ * table configuration, fitness function and magic constant, FITNESS is exact
+ * hexadecimal floating point value and KEY is cache key of phenotype of
+ * LENGTH bytes.
+ * Lines of other configurations are ignored, so cache is invalidated
+ * automatically when any of them changes, and single file can serve
+ * different experiments. Concurrent processes append whole batches under
+ * exclusive lock and read under shared lock (flock), each process reading
+ * only lines appended since its previous read. Incomplete last line left by
+ * interrupted process is never parsed.
+ */
+class GEPersistentCache {
+
+  public:
+    /**
+     * @brief Cached fitness values, by cache key.
+     */
+    using Map = std::unordered_map<std::string, gram::Fitness>;
+
+    /**
+     * @brief Constructor opening (or creating) cache file.
+     * @param [in] path Path to cache file.
+     * @param [in] config Description of everything fitness depends on
+     * besides phenotype.
+     * @exception cacheOpenError File could not be opened.
+     */
+    GEPersistentCache(const std::string &path, const std::string &config);
+
+    GEPersistentCache(const GEPersistentCache &) = delete;
+    GEPersistentCache &operator=(const GEPersistentCache &) = delete;
+
+    /**
+     * @brief Read entries appended since previous call.
+     * @details Entries of current configuration are inserted into cache,
+     * keys already present are kept.
+     * @param [in out] cache Cache to be filled.
+     * @return Number of inserted entries.
+     * @exception cacheIOError File could not be read.
+     */
+    size_t load(Map &cache);
+
+    /**
+     * @brief Append entries to file.
+     * @details Keys containing line or field separator are skipped.
+     * @param [in] entries Cache keys and their fitness.
+     * @exception cacheIOError File could not be written.
+     */
+    void append(const std::vector<std::pair<std::string, gram::Fitness>>
+                    &entries);
+
+    /**
+     * @brief Get identifier of configuration written to file.
+     * @return 16 hexadecimal digits.
+     */
+    const std::string &configId(void) const { return id; };
+
+    /**
+     * @brief Destructor closing file.
+     */
+    ~GEPersistentCache();
+
+  private:
+    /**
+     * @brief Descriptor of opened file.
+     */
+    int fd = -1;
+
+    /**
+     * @brief Identifier of current configuration.
+     */
+    std::string id;
+
+    /**
+     * @brief Offset of first unread byte.
+     */
+    off_t offset = 0;
+
+    /**
+     * @brief Parse single line and insert its entry into cache.
+     * @param [in] line Line without terminating newline.
+     * @param [in out] cache Cache to be filled.
+     * @return True if entry was inserted.
+     */
+    bool parseLine(const std::string &line, Map &cache) const;
+};
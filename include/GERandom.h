@@ -0,0 +1,58 @@
+/**
+ * @file GERandom.h
+ * @author Adam Freiberg (xfreib00@stud.fit.vutbr.cz)
+ * @brief Header file for seeded random number generation
+ * @version 0.1
+ * @date 2021-07-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <gram/random/number_generator/NumberGenerator.h>
+#include <random>
+
+/**
+ * @brief Derive well mixed 64-bit value from given one (SplitMix64).
+ * @details Used to derive independent seeds of generators from single seed
+ * of run, consecutive inputs give unrelated outputs.
+ * @param [in] x Input value.
+ * @return Mixed value.
+ */
+constexpr uint64_t splitmix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+/**
+ * @brief Number generator for gram operators with explicit seed.
+ * @details Runs seeded with the same value are reproducible.
+ */
+class GENumberGenerator : public gram::NumberGenerator {
+
+  public:
+    /**
+     * @brief Constructor of GENumberGenerator class.
+     * @param [in] seed Seed of generator.
+     */
+    explicit GENumberGenerator(uint64_t seed) : engine(seed){};
+
+    /**
+     * @brief Generate next random number.
+     * @return Random number.
+     */
+    unsigned long generate(void) override {
+        return static_cast<unsigned long>(engine());
+    };
+
+  private:
+    /**
+     * @brief Underlying random engine.
+     */
+    std::mt19937_64 engine;
+};
@@ -0,0 +1,87 @@
+/**
+ * @file GESpscQueue.h
+ * @author Adam Freiberg (xfreib00@stud.fit.vutbr.cz)
+ * @brief Header file for GESpscQueue class
+ * @version 0.1
+ * @date 2021-07-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Bounded lock-free queue for single producer and single consumer.
+ * @details Ring buffer of Capacity slots. Producer writes only tail and
+ * consumer writes only head, each published with release store, so neither
+ * side ever blocks the other. Used by GELogger to pass snapshots of
+ * generations to background thread.
+ * @tparam T Type of stored items, must be default constructible and movable.
+ * @tparam Capacity Number of slots, power of two.
+ */
+template <typename T, size_t Capacity = 64> class GESpscQueue {
+
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                  "capacity must be power of two");
+
+  public:
+    /**
+     * @brief Constructor allocating all slots.
+     */
+    GESpscQueue() : slots(Capacity){};
+
+    GESpscQueue(const GESpscQueue &) = delete;
+    GESpscQueue &operator=(const GESpscQueue &) = delete;
+
+    /**
+     * @brief Append item, called only by producer.
+     * @param [in] item Item to be appended.
+     * @return False if queue is full, item is left untouched.
+     */
+    bool push(T &item) {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        slots[t & (Capacity - 1)] = std::move(item);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    };
+
+    /**
+     * @brief Remove first item, called only by consumer.
+     * @return First item, or empty if queue is empty.
+     */
+    std::optional<T> pop(void) {
+        const size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) {
+            return std::nullopt;
+        }
+        std::optional<T> item(std::move(slots[h & (Capacity - 1)]));
+        head.store(h + 1, std::memory_order_release);
+        return item;
+    };
+
+  private:
+    /**
+     * @brief Storage of items.
+     */
+    std::vector<T> slots;
+
+    /**
+     * @brief Number of removed items, written by consumer.
+     */
+    alignas(64) std::atomic<size_t> head{0};
+
+    /**
+     * @brief Number of appended items, written by producer.
+     */
+    alignas(64) std::atomic<size_t> tail{0};
+};
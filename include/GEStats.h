@@ -0,0 +1,158 @@
+/**
+ * @file GEStats.h
+ * @author Adam Freiberg (xfreib00@stud.fit.vutbr.cz)
+ * @brief Header file for GEStats structure
+ * @version 0.1
+ * @date 2021-07-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include "GEPerfCounters.h"
+#include <cstddef>
+#include <gram/individual/Fitness.h>
+#include <limits>
+#include <vector>
+
+/**
+ * @brief Statistics of evaluation of last generation.
+ * @details Filled by GEDriver after each generation and written to output
+ * by GELogger.
+ */
+struct GEStats {
+    /**
+     * @brief Counts of single stage of staged evaluation.
+     */
+    struct Stage {
+        /**
+         * @brief Fraction of training data used by stage.
+         */
+        double fraction = 0.0;
+
+        /**
+         * @brief Number of phenotypes evaluated on sample.
+         */
+        size_t evaluated = 0;
+
+        /**
+         * @brief Number of phenotypes promoted to next stage.
+         */
+        size_t promoted = 0;
+    };
+
+    /**
+     * @brief Wall time of phases of generation in seconds.
+     */
+    struct Time {
+        /**
+         * @brief Mapping of genotypes and lookup in fitness cache.
+         */
+        double map = 0.0;
+
+        /**
+         * @brief Staged evaluation on subsamples of training data.
+         */
+        double stages = 0.0;
+
+        /**
+         * @brief Evaluation on whole training set.
+         */
+        double evaluate = 0.0;
+
+        /**
+         * @brief Creation of generation by gram::Population::reproduce.
+         */
+        double reproduce = 0.0;
+
+        /**
+         * @brief Logging of previous generation.
+         */
+        double log = 0.0;
+
+        /**
+         * @brief Whole generation, including phases above.
+         */
+        double total = 0.0;
+    };
+
+    /**
+     * @brief Number of individuals in generation.
+     */
+    size_t individuals = 0;
+
+    /**
+     * @brief Number of phenotypes evaluated on whole training set.
+     */
+    size_t evaluated = 0;
+
+    /**
+     * @brief Number of individuals whose fitness was found in cache.
+     */
+    size_t cache_hits = 0;
+
+    /**
+     * @brief Number of individuals with the same cache key as other
+     * individual of generation evaluated instead of them.
+     */
+    size_t duplicates = 0;
+
+    /**
+     * @brief Number of fitness values loaded from persistent cache before
+     * generation.
+     */
+    size_t loaded = 0;
+
+    /**
+     * @brief Number of evaluations stopped early by cutoff.
+     */
+    size_t truncated = 0;
+
+    /**
+     * @brief Cutoff used for generation, infinity if none.
+     */
+    gram::Fitness cutoff = std::numeric_limits<gram::Fitness>::infinity();
+
+    /**
+     * @brief Counts of each stage of staged evaluation.
+     */
+    std::vector<Stage> stages;
+
+    /**
+     * @brief True if fields below were measured, see GEDriver::setTiming.
+     */
+    bool timed = false;
+
+    /**
+     * @brief Wall time of phases of generation.
+     */
+    Time time;
+
+    /**
+     * @brief Number of keys hashed during generation.
+     */
+    size_t keys_hashed = 0;
+
+    /**
+     * @brief Peak resident set size of process in KiB.
+     */
+    size_t peak_rss = 0;
+
+    /**
+     * @brief Hardware counters of evaluation of generation, filled by
+     * GEEvolution when counters are set. Empty mask if not counted.
+     */
+    GEPerfCounts evaluate_counts;
+
+    /**
+     * @brief Hardware counters of reproduction creating generation.
+     */
+    GEPerfCounts reproduce_counts;
+
+    /**
+     * @brief Hardware counters of both phases summed over run so far.
+     */
+    GEPerfCounts total_counts;
+};
@@ -0,0 +1,135 @@
+/**
+ * @file GEThreadPool.h
+ * @author Adam Freiberg (xfreib00@stud.fit.vutbr.cz)
+ * @brief Header file for GEThreadPool class
+ * @version 0.1
+ * @date 2021-07-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Fixed size pool of threads executing parallel loops.
+ * @details Threads are created once and sleep between jobs. Calling thread
+ * takes part in each job as worker 0, so pool of size 1 runs everything
+ * inline without any synchronization.
+ */
+class GEThreadPool {
+
+  public:
+    /// Type of executed task, called with task index and worker index.
+    using Task = std::function<void(size_t, size_t)>;
+
+    /**
+     * @brief Constructor of GEThreadPool class.
+     * @param [in] threads Number of workers including calling thread. Zero
+     * means number of hardware threads.
+     */
+    explicit GEThreadPool(size_t threads);
+
+    GEThreadPool(const GEThreadPool &) = delete;
+    GEThreadPool &operator=(const GEThreadPool &) = delete;
+
+    /**
+     * @brief Get number of workers.
+     * @return Number of workers including calling thread.
+     */
+    size_t size(void) const { return workers.size() + 1; };
+
+    /**
+     * @brief Execute tasks in parallel and wait for their completion.
+     * @details Each index in range [0, tasks) is passed to fn exactly once,
+     * together with index of worker executing it. Worker index is lower than
+     * GEThreadPool::size, so it can be used to select per-worker state.
+     * @param [in] tasks Number of tasks.
+     * @param [in] fn Function executing single task.
+     * @exception First exception thrown by any task is rethrown after all
+     * workers finish.
+     */
+    void run(size_t tasks, const Task &fn);
+
+    /**
+     * @brief Destructor stopping and joining all threads.
+     */
+    ~GEThreadPool();
+
+  private:
+    /**
+     * @brief Main loop of pool thread.
+     * @param [in] id Index of worker.
+     */
+    void loop(size_t id);
+
+    /**
+     * @brief Execute tasks of current job until none is left.
+     * @param [in] id Index of worker.
+     */
+    void work(size_t id);
+
+    /**
+     * @brief Pool threads.
+     */
+    std::vector<std::thread> workers;
+
+    /**
+     * @brief Mutex guarding job state.
+     */
+    std::mutex mtx;
+
+    /**
+     * @brief Condition signalling new job or stop request.
+     */
+    std::condition_variable start;
+
+    /**
+     * @brief Condition signalling that all workers finished job.
+     */
+    std::condition_variable done;
+
+    /**
+     * @brief Currently executed function.
+     */
+    const Task *job = nullptr;
+
+    /**
+     * @brief Number of tasks in current job.
+     */
+    size_t job_tasks = 0;
+
+    /**
+     * @brief Index of next task to be executed.
+     */
+    std::atomic<size_t> next{0};
+
+    /**
+     * @brief Counter of started jobs, used to wake up workers.
+     */
+    size_t generation = 0;
+
+    /**
+     * @brief Number of pool threads still working on current job.
+     */
+    size_t active = 0;
+
+    /**
+     * @brief First exception thrown by task of current job.
+     */
+    std::exception_ptr error;
+
+    /**
+     * @brief Flag requesting threads to exit.
+     */
+    bool stop = false;
+};
@@ -11,29 +11,68 @@
 
 #pragma once
 
+#include "HashJIT.h"
+#include "HashSIMD.h"
+#include "HashVM.h"
 #include "error/hashError.h"
+#include <algorithm>
 #include <array>
-#include <chaiscript/chaiscript.hpp>
 #include <limits>
 #include <string>
 #include <vector>
 
-using namespace std;
+#ifdef GEHASH_USE_CHAISCRIPT
+#include <chaiscript/chaiscript.hpp>
 using namespace chaiscript;
+#endif
+
+using namespace std;
+
+/**
+ * @brief Backends used for evaluating generated hash functions.
+ */
+enum class HashEngine {
+    /// Bytecode interpreter, see HashVM.
+    VM,
+    /// Native code compiled by HashJIT, HashVM is used as fallback.
+    JIT,
+    /// HashVM bytecode run over blocks of keys in SIMD lanes, see HashSIMD.
+    SIMD,
+    /// ChaiScript engine used as reference implementation.
+    ChaiScript
+};
 
 /**
  * @brief Class implementing basic hash table.
- * @tparam T Data type specifying range of hash table indexes.
+ * @details Table has 2^Bits indexes, 64-bit hash value is reduced to index
+ * by xor-folding.
+ * @tparam Bits Number of bits of table index.
  * @tparam V Data type of records.
  */
-template <typename T, typename V, typename = enable_if_t<is_integral<T>::value>>
-class HTable {
+template <unsigned Bits, typename V> class HTable {
+
+    static_assert(Bits >= 1 && Bits <= 32, "unsupported table size");
 
   public:
+    /**
+     * @brief Data type of table indexes.
+     */
+    using Index = uint32_t;
+
+    /**
+     * @brief Number of keys mapped to each index of table.
+     */
+    using Dimensions = vector<uint32_t>;
+
+    /**
+     * @brief Number of table indexes.
+     */
+    static constexpr size_t size = static_cast<size_t>(1) << Bits;
+
     /**
      * @brief HTable constructor.
      */
-    HTable() = default;
+    HTable() : counts(size) {};
 
     /**
      * @brief Insert element to table.
@@ -42,7 +81,7 @@ class HTable {
      * thrown.
      */
     void Insert(V key) {
-        /*if (T hash = get_hash(key); table[hash].empty()) {
+        /*if (Index hash = get_hash(key); table[hash].empty()) {
             table[hash].push_back(key);
         } else {
             auto it = table[hash].begin();
@@ -59,18 +98,54 @@ class HTable {
 
         /* use simple push_back to find out how many keys will be mapped to
          * single index */
-        T hash = get_hash(key);
-        table[hash].push_back(key);
+        Index hash = get_hash(key);
+        increment(hash);
+        if (!count_only) {
+            allocate();
+            table[hash].push_back(key);
+        }
+    };
+
+    /**
+     * @brief Insert multiple elements to table.
+     * @details Keys are hashed in blocks using HTable::Hash for multiple keys,
+     * so vectorized backend can be used.
+     * @param [in] keys Pointer to first key.
+     * @param [in] count Number of keys.
+     */
+    void Insert(const V *keys, size_t count) {
+        if (!isConcurrent()) {
+            for (size_t i = 0; i < count; i++) {
+                Insert(keys[i]);
+            }
+            return;
+        }
+
+        array<Index, batch> hashes;
+        for (size_t first = 0; first < count; first += batch) {
+            const size_t n = std::min(batch, count - first);
+            Hash(keys + first, n, hashes.data());
+            for (size_t i = 0; i < n; i++) {
+                increment(hashes[i]);
+            }
+            if (!count_only) {
+                allocate();
+                for (size_t i = 0; i < n; i++) {
+                    table[hashes[i]].push_back(keys[first + i]);
+                }
+            }
+        }
     };
 
     /**
      * @brief Remove element from table.
      * @param [in] key Key to be removed from table.
      * @exception If key is not in table hashRemoveError exception is thrown.
+     * Keys are not stored in count-only mode, so exception is always thrown.
      */
     void Remove(V key) {
-        T hash = get_hash(key);
-        if (table[hash].empty()) {
+        Index hash = get_hash(key);
+        if (table.empty() || table[hash].empty()) {
             throw hashRemoveError();
         }
 
@@ -79,6 +154,7 @@ class HTable {
         for (; it != table[hash].end();) {
             if (*it == key) {
                 it = table[hash].erase(it);
+                decrement(hash);
                 break;
             } else {
                 it++;
@@ -94,10 +170,11 @@ class HTable {
      * @param [in] key Key to be found in table.
      * @return Return index if search was successful. Throw exception otherwise.
      * @exception If key is not in table hashSearchError exception is thrown.
+     * Keys are not stored in count-only mode, so exception is always thrown.
      */
-    T Search(V key) {
-        T hash = get_hash(key);
-        if (table[hash].empty()) {
+    Index Search(V key) {
+        Index hash = get_hash(key);
+        if (table.empty() || table[hash].empty()) {
             throw hashSearchError();
         }
 
@@ -116,9 +193,127 @@ class HTable {
 
     /**
      * @brief Set function to be evaluated and used in calculating hash value.
+     * @details Function is compiled for HashVM (and HashJIT) once here. If
+     * JIT can not handle given function, HashVM is used. If VM can not handle
+     * it either, ChaiScript is used instead when available.
      * @param [in] f String representation of generated function.
+     * @exception hashCompileError Function could not be compiled and
+     * ChaiScript backend is not available.
+     */
+    void setFunc(string f) {
+        func = f;
+        use_vm = false;
+        use_jit = false;
+        use_simd = false;
+
+        if (engine != HashEngine::ChaiScript) {
+            try {
+                vm.compile(func);
+                use_vm = true;
+                use_jit = engine == HashEngine::JIT && jit.compile(vm);
+                use_simd = engine == HashEngine::SIMD &&
+                           V{}.size() <= HashSIMD::max_words;
+                if (use_simd) {
+                    simd.compile(vm);
+                }
+            } catch (hashCompileError &e) {
+                /* fall back to ChaiScript if it is available */
+#ifndef GEHASH_USE_CHAISCRIPT
+                throw;
+#endif
+            }
+        }
+    };
+
+    /**
+     * @brief Check if hash values can be computed concurrently.
+     * @details Compiled backends (HashVM and HashJIT) do not modify any state
+     * while hashing, so HTable::Hash may be called from multiple threads.
+     * ChaiScript engine can not be shared between threads.
+     * @return True if HTable::Hash can be used for current function.
+     */
+    bool isConcurrent(void) const { return use_vm || use_jit; };
+
+    /**
+     * @brief Get number of significant bits of raw hash value.
+     * @details Upper half of 32-bit result is zero or copy of its sign bit.
+     * Result type is known only for compiled function, ChaiScript results
+     * are taken as 64-bit.
+     * @return 32 if current function has 32-bit result type, 64 otherwise.
+     */
+    unsigned outputBits(void) const {
+        return use_vm && isNarrow(vm.resultType()) ? 32 : 64;
+    };
+
+    /**
+     * @brief Calculate hash value of key without inserting it.
+     * @details Thread-safe variant of hashing used for evaluating parts of
+     * training data in parallel.
+     * @param [in] key Key to be hashed.
+     * @return Calculated hash value.
+     * @exception hashFuncError Current function is not compiled, see
+     * HTable::isConcurrent.
      */
-    void setFunc(string f) { func = f; };
+    Index Hash(const V &key) const {
+        if (use_jit) {
+            return fold(jit.run(key.data(), key.size(), magic_num));
+        }
+        if (use_vm) {
+            return fold(vm.run(key.data(), key.size(), magic_num));
+        }
+        throw hashFuncError();
+    };
+
+    /**
+     * @brief Calculate hash values of multiple keys without inserting them.
+     * @details Thread-safe like HTable::Hash. With HashEngine::SIMD keys are
+     * hashed by HashSIMD, other backends hash keys one by one.
+     * @param [in] keys Pointer to first key, keys must be stored
+     * contiguously.
+     * @param [in] count Number of keys, at most HTable::batch.
+     * @param [out] out Array of count calculated hash values.
+     * @exception hashFuncError Current function is not compiled, see
+     * HTable::isConcurrent.
+     */
+    void Hash(const V *keys, size_t count, Index *out) const {
+        array<uint64_t, batch> raw;
+        compiled_hash(keys, count, raw.data());
+        for (size_t i = 0; i < count; i++) {
+            out[i] = fold(raw[i]);
+        }
+    };
+
+    /**
+     * @brief Calculate full 64-bit hash values of multiple keys.
+     * @details Values are not reduced to table indexes, so caller can map
+     * them to tables of other sizes. Thread-safe if HTable::isConcurrent
+     * returns true.
+     * @param [in] keys Pointer to first key, keys must be stored
+     * contiguously.
+     * @param [in] count Number of keys, at most HTable::batch.
+     * @param [out] out Array of count calculated hash values.
+     * @exception hashFuncError No function was set.
+     */
+    void HashRaw(const V *keys, size_t count, uint64_t *out) {
+        if (isConcurrent()) {
+            compiled_hash(keys, count, out);
+            return;
+        }
+        for (size_t i = 0; i < count; i++) {
+            out[i] = raw_hash(keys[i]);
+        }
+    };
+
+    /**
+     * @brief Number of keys hashed at once by HTable::Hash for multiple keys.
+     */
+    static constexpr size_t batch = 256;
+
+    /**
+     * @brief Select backend used for evaluating hash function.
+     * @param [in] e Selected backend. Takes effect on next HTable::setFunc.
+     */
+    void setEngine(HashEngine e) { engine = e; };
 
     /**
      * @brief Set magic number used in calculating hash value.
@@ -129,21 +324,39 @@ class HTable {
     /**
      * @brief Get the size of table
      *
-     * @return constexpr T Size of table
+     * @return constexpr size_t Size of table
+     */
+    constexpr size_t getSize(void) const { return size; };
+
+    /**
+     * @brief Get element count at each index of hash table.
+     * @details Counts are maintained by insertion, no copy is made.
+     * @return Reference to array of element counts for each index of HTable.
      */
-    constexpr size_t getSize(void) const { return table.size(); };
+    const Dimensions &getDimensions(void) const { return counts; };
 
     /**
-     * @brief Function fills given array with element count
-     * at each index of hash table.
-     * @return Array filled with elemenent count for each index of HTable.
+     * @brief Get sum of squared element counts of indexes with more than one
+     * element.
+     * @details Value is maintained during insertion, so it can be used to
+     * track fitness while keys are being inserted. It never decreases on
+     * insertion.
+     * @return Sum of squares of colliding counts.
      */
-    array<T, numeric_limits<T>::max()> getDimensions(void) {
-        array<T, numeric_limits<T>::max()> arr;
-        for (size_t i = 0; i < table.size(); i++) {
-            arr[i] = static_cast<T>(table[i].size());
+    uint64_t getSquares(void) const { return squares; };
+
+    /**
+     * @brief Keep only number of keys at each index instead of keys.
+     * @details Count-only table does not allocate memory on insertion, which
+     * is sufficient for computing fitness. Table is cleared.
+     * @param [in] c True to enable count-only mode.
+     */
+    void setCountOnly(bool c) {
+        count_only = c;
+        clearTab();
+        if (count_only) {
+            table = vector<vector<V>>();
         }
-        return arr;
     };
 
     /**
@@ -151,6 +364,8 @@ class HTable {
      * @throw Noexcept is quaranteed.
      */
     void clearTab(void) noexcept {
+        std::fill(counts.begin(), counts.end(), 0);
+        squares = 0;
         for (auto &i : table) {
             i.clear();
         }
@@ -168,9 +383,19 @@ class HTable {
      * @return Calculated hash value.
      * @exception If no function was not set by HTable::setFunc
      * or given string was empty, throw hashFuncError exception.
-     * If Lua evaluation fails, throw hashLuaError exception.
+     * If evaluation fails, exception of used backend is propagated.
+     */
+    Index get_hash(V key) { return fold(raw_hash(key)); };
+
+    /**
+     * @brief Calculate 64-bit hash value of key using any backend.
+     * @param [in] key Key to be hashed.
+     * @return Hash value before reduction to table index.
+     * @exception If no function was not set by HTable::setFunc
+     * or given string was empty, throw hashFuncError exception.
+     * If evaluation fails, exception of used backend is propagated.
      */
-    T get_hash(V key) {
+    uint64_t raw_hash(const V &key) {
         if (func.empty()) {
             throw hashFuncError();
         }
@@ -178,47 +403,160 @@ class HTable {
         /* initial value of hash */
         uint64_t hash = 0;
 
-        /* push magic_num as constant to chaiScript engine */
-        chai.add(const_var(magic_num), "magic");
+        if (use_jit) {
+            hash = jit.run(key.data(), key.size(), magic_num);
+        } else if (use_vm) {
+            hash = vm.run(key.data(), key.size(), magic_num);
+        } else {
+#ifdef GEHASH_USE_CHAISCRIPT
+            /* push magic_num as constant to chaiScript engine */
+            chai.add(const_var(magic_num), "magic");
 
-        /* push initial hash value to engine to be used in iterations */
-        chai.add(var(hash), "hash");
+            /* push initial hash value to engine to be used in iterations */
+            chai.add(var(hash), "hash");
 
-        for (auto &k : key) {
-            /* push current value of key to engine */
-            chai.add(const_var(k), "key");
+            for (auto &k : key) {
+                /* push current value of key to engine */
+                chai.add(const_var(k), "key");
 
-            /* return new hash value for each loop */
-            hash = chai.eval<uint64_t>(func);
+                /* return new hash value for each loop */
+                hash = chai.eval<uint64_t>(func);
+            }
+#else
+            throw hashFuncError();
+#endif
         }
 
-        /* use xor-folding if needed to return hash value in specified range */
-        switch (sizeof(T)) {
-        case 2:
-            return static_cast<T>((((hash >> (sizeof(T) * 8)) ^ hash) &
-                                   (((static_cast<T>(1) << (sizeof(T) * 8)) -
-                                     static_cast<T>(1)))));
-            break;
-        case 4:
-            return static_cast<T>(
-                (hash >> (sizeof(T) * 8)) ^
-                (hash & (((static_cast<T>(1) << (sizeof(T) * 8)) -
-                          static_cast<T>(1)))));
-        default:
-            return static_cast<T>(hash);
-            break;
+        return hash;
+    };
+
+    /**
+     * @brief Calculate 64-bit hash values of keys using compiled backend.
+     * @param [in] keys Pointer to first key.
+     * @param [in] count Number of keys.
+     * @param [out] out Array of count calculated hash values.
+     * @exception hashFuncError Current function is not compiled.
+     */
+    void compiled_hash(const V *keys, size_t count, uint64_t *out) const {
+        if (use_simd) {
+            simd.run(keys->data(), count, keys->size(), magic_num, out);
+            return;
+        }
+        if (!isConcurrent()) {
+            throw hashFuncError();
+        }
+        for (size_t i = 0; i < count; i++) {
+            out[i] = use_jit
+                         ? jit.run(keys[i].data(), keys[i].size(), magic_num)
+                         : vm.run(keys[i].data(), keys[i].size(), magic_num);
+        }
+    };
+
+    /**
+     * @brief Reduce 64-bit hash value to range of table indexes.
+     * @details Upper bits are xor-folded to lower ones, which keeps
+     * behaviour of original 16-bit table for Bits = 16.
+     * @param [in] hash Hash value returned by backend.
+     * @return Index of table.
+     */
+    static constexpr Index fold(uint64_t hash) {
+        return static_cast<Index>(((hash >> Bits) ^ hash) & mask);
+    };
+
+    /**
+     * @brief Mask of valid index bits.
+     */
+    static constexpr uint64_t mask = (static_cast<uint64_t>(1) << Bits) - 1;
+
+    /**
+     * @brief Increment element count of index.
+     * @param [in] hash Index of table.
+     */
+    void increment(Index hash) {
+        /* (c + 1)^2 - c^2 = 2c + 1, first collision adds both elements */
+        const uint64_t c = counts[hash]++;
+        squares += c == 0 ? 0 : (c == 1 ? 4 : 2 * c + 1);
+    };
+
+    /**
+     * @brief Decrement element count of index.
+     * @param [in] hash Index of table.
+     */
+    void decrement(Index hash) {
+        const uint64_t c = counts[hash]--;
+        squares -= c <= 1 ? 0 : (c == 2 ? 4 : 2 * c - 1);
+    };
+
+    /**
+     * @brief Allocate buckets storing keys on first use.
+     */
+    void allocate(void) {
+        if (table.empty()) {
+            table.resize(size);
         }
     };
 
     /**
-     * @brief Table alocated using std::array
+     * @brief Buckets with stored keys, empty in count-only mode.
+     */
+    vector<vector<V>> table;
+
+    /**
+     * @brief Number of keys at each index of table.
+     */
+    Dimensions counts;
+
+    /**
+     * @brief Sum of squared counts greater than one.
+     */
+    uint64_t squares = 0;
+
+    /**
+     * @brief Flag if keys are not stored, only counted.
+     */
+    bool count_only = false;
+
+    /**
+     * @brief Compiled hash function.
+     */
+    HashVM vm;
+
+    /**
+     * @brief Native code of hash function.
+     */
+    HashJIT jit;
+
+    /**
+     * @brief Vectorized evaluation of compiled function.
+     */
+    HashSIMD simd;
+
+    /**
+     * @brief Selected backend.
+     */
+    HashEngine engine = HashEngine::VM;
+
+    /**
+     * @brief Flag if current function is evaluated by HashVM.
+     */
+    bool use_vm = false;
+
+    /**
+     * @brief Flag if current function is evaluated by HashJIT.
+     */
+    bool use_jit = false;
+
+    /**
+     * @brief Flag if current function is evaluated by HashSIMD.
      */
-    array<vector<V>, numeric_limits<T>::max()> table;
+    bool use_simd = false;
 
+#ifdef GEHASH_USE_CHAISCRIPT
     /**
      * @brief ChaiScript class object.
      */
     ChaiScript chai;
+#endif
 
     /**
      * @brief Magic number used in calculating hash value.
@@ -0,0 +1,125 @@
+/**
+ * @file HashExport.h
+ * @author Adam Freiberg (xfreib00@stud.fit.vutbr.cz)
+ * @brief Header file for HashExporter class
+ * @version 0.1
+ * @date 2021-07-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include "HashExpr.h"
+#include "HashReducer.h"
+#include "error/hashError.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Export of evolved hash function as standalone source code.
+ * @details Function is translated from its expression tree into C
+ * expressions with the same semantics as HashVM, so exported code computes
+ * the same hash values as evaluation during evolution. Magic constant is
+ * substituted. Division by zero, which fails evaluation during evolution,
+ * yields zero in exported code.
+ */
+class HashExporter {
+
+  public:
+    /**
+     * @brief Constructor of HashExporter class.
+     * @param [in] phenotype String representation of hash function.
+     * @param [in] magic Value of magic constant.
+     * @param [in] reducers Reductions of hash value to table index, index
+     * function is exported for each of them. First one is used by
+     * benchmark.
+     * @exception hashCompileError Function can not be parsed.
+     */
+    HashExporter(const std::string &phenotype, uint64_t magic,
+                 std::vector<HashReducer> reducers);
+
+    /**
+     * @brief Generate C++ header with constexpr functions.
+     * @param [in] name Name of hash function, used as prefix of all
+     * identifiers.
+     * @return Content of header file.
+     */
+    std::string cppHeader(const std::string &name) const;
+
+    /**
+     * @brief Generate C header with static inline functions.
+     * @param [in] name Name of hash function, used as prefix of all
+     * identifiers.
+     * @return Content of header file.
+     */
+    std::string cHeader(const std::string &name) const;
+
+    /**
+     * @brief Generate benchmark of exported function.
+     * @details Benchmark measures ns/key and keys/s of exported function,
+     * FNV-1a, CRC32C and multiply-xorshift hash, each followed by the first
+     * reduction, on training keys (text or binary file) and reports maximal
+     * load of table for each of them.
+     * @param [in] name Name of hash function given to
+     * HashExporter::cppHeader.
+     * @param [in] header Path to C++ header included by benchmark.
+     * @param [in] data_path Default path to training data.
+     * @return Content of C++ source file.
+     */
+    std::string benchmark(const std::string &name, const std::string &header,
+                          const std::string &data_path) const;
+
+    /**
+     * @brief Write C++ header, C header and benchmark.
+     * @details Files PREFIX.hpp, PREFIX.h and PREFIX_bench.cpp are created,
+     * name of function is derived from file name of prefix.
+     * @param [in] prefix Path and name of created files without extension.
+     * @param [in] data_path Default path to training data used by benchmark.
+     * @exception hashExportError File could not be written.
+     */
+    void write(const std::string &prefix, const std::string &data_path) const;
+
+    /**
+     * @brief Default destructor.
+     */
+    ~HashExporter() = default;
+
+  private:
+    /**
+     * @brief Translate expression tree node into C expression.
+     * @param [in] n Translated node.
+     * @param [in] name Prefix of helper functions.
+     * @return Expression of type uint64_t holding canonical value of node.
+     */
+    std::string expression(const HashNode &n, const std::string &name) const;
+
+    /**
+     * @brief Generate body of hash function shared by C and C++ variant.
+     * @param [in] name Prefix of helper functions.
+     * @return Statements computing hash value of key.
+     */
+    std::string body(const std::string &name) const;
+
+    /**
+     * @brief Source of hash function.
+     */
+    std::string phenotype;
+
+    /**
+     * @brief Value of magic constant.
+     */
+    uint64_t magic;
+
+    /**
+     * @brief Expression trees of statements of hash function.
+     */
+    HashAst ast;
+
+    /**
+     * @brief Reductions of hash value to table index.
+     */
+    std::vector<HashReducer> reducers;
+};
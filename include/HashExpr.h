@@ -0,0 +1,346 @@
+/**
+ * @file HashExpr.h
+ * @author Adam Freiberg (xfreib00@stud.fit.vutbr.cz)
+ * @brief Header file for hash function expression tree and HashParser class
+ * @version 0.1
+ * @date 2021-07-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include "error/hashError.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Value types used in generated hash functions.
+ * @details Types are ordered by conversion rank, so common type of two
+ * operands is always the greater one. This corresponds to C++ usual
+ * arithmetic conversions used by ChaiScript for integer operands.
+ */
+enum class HashType : uint8_t { Int32, UInt32, Int64, UInt64 };
+
+/**
+ * @brief Operations and operands of hash function expression tree.
+ */
+enum class HashOp : uint8_t {
+    Hash,
+    Key,
+    Magic,
+    Const,
+    Not,
+    Neg,
+    Add,
+    Sub,
+    Mul,
+    Div,
+    Mod,
+    And,
+    Or,
+    Xor,
+    Shl,
+    Shr
+};
+
+/**
+ * @brief Node of hash function expression tree.
+ */
+struct HashNode {
+    /**
+     * @brief Operation or operand represented by node.
+     */
+    HashOp op;
+
+    /**
+     * @brief Result type of node.
+     */
+    HashType type;
+
+    /**
+     * @brief Value of constant node stored in canonical form.
+     */
+    uint64_t value = 0;
+
+    /**
+     * @brief Left (or only) operand.
+     */
+    std::unique_ptr<HashNode> lhs;
+
+    /**
+     * @brief Right operand.
+     */
+    std::unique_ptr<HashNode> rhs;
+};
+
+/**
+ * @brief Generated hash function as list of assignments to hash variable.
+ * @details Compound assignments are expanded to plain ones, so each
+ * statement is just expression which result is stored in hash.
+ */
+using HashAst = std::vector<std::unique_ptr<HashNode>>;
+
+/**
+ * @brief Return common type of two operands.
+ * @param [in] a Type of left operand.
+ * @param [in] b Type of right operand.
+ * @return Type both operands are converted to.
+ */
+constexpr HashType commonType(HashType a, HashType b) { return a > b ? a : b; }
+
+/**
+ * @brief Check if type is 32 bits wide.
+ * @param [in] t Checked type.
+ * @return True for Int32 and UInt32.
+ */
+constexpr bool isNarrow(HashType t) {
+    return t == HashType::Int32 || t == HashType::UInt32;
+}
+
+/**
+ * @brief Check if type is signed.
+ * @param [in] t Checked type.
+ * @return True for Int32 and Int64.
+ */
+constexpr bool isSigned(HashType t) {
+    return t == HashType::Int32 || t == HashType::Int64;
+}
+
+/**
+ * @brief Convert 64-bit value to canonical form of given type.
+ * @details Values are always held in 64-bit registers. 32-bit unsigned
+ * values are zero-extended and 32-bit signed values are sign-extended, so
+ * conversion to any wider type is a no-op.
+ * @param [in] t Target type.
+ * @param [in] v Value to be converted.
+ * @return Canonical form of value.
+ */
+constexpr uint64_t canonical(HashType t, uint64_t v) {
+    switch (t) {
+    case HashType::Int32:
+        return static_cast<uint64_t>(
+            static_cast<int64_t>(static_cast<int32_t>(v)));
+    case HashType::UInt32:
+        return v & 0xFFFFFFFFull;
+    default:
+        return v;
+    }
+}
+
+/**
+ * @brief Class for parsing hash functions generated by grammar.
+ * @details Parser accepts subset of ChaiScript used by GEHash grammars:
+ * assignments (plain or compound) to variable hash built from variables
+ * hash, key and magic, integer literals, unary operators ~ - + and binary
+ * operators * / % + - << >> & ^ | with C operator precedence.
+ */
+class HashParser {
+
+  public:
+    /**
+     * @brief Default constructor.
+     */
+    HashParser() = default;
+
+    /**
+     * @brief Parse given hash function.
+     * @param [in] src String representation of generated function.
+     * @return Expression trees of all statements.
+     * @exception hashCompileError Function uses unsupported construct or is
+     * not valid.
+     */
+    HashAst parse(const std::string &src);
+
+    /**
+     * @brief Default destructor.
+     */
+    ~HashParser() = default;
+
+  private:
+    /**
+     * @brief Token kinds produced by lexer.
+     */
+    enum class Token : uint8_t { End, Ident, Number, Op, Semicolon };
+
+    /**
+     * @brief Read next token from source string.
+     */
+    void next(void);
+
+    /**
+     * @brief Parse single statement.
+     * @return Expression tree of statement.
+     */
+    std::unique_ptr<HashNode> statement(void);
+
+    /**
+     * @brief Parse binary expression using precedence climbing.
+     * @param [in] level Minimal precedence of parsed operators.
+     * @return Expression tree of parsed expression.
+     */
+    std::unique_ptr<HashNode> binary(int level);
+
+    /**
+     * @brief Parse unary expression.
+     * @return Expression tree of parsed expression.
+     */
+    std::unique_ptr<HashNode> unary(void);
+
+    /**
+     * @brief Parse primary expression (variable, literal or parentheses).
+     * @return Expression tree of parsed expression.
+     */
+    std::unique_ptr<HashNode> primary(void);
+
+    /**
+     * @brief Create integer literal node from current token.
+     * @return Constant node typed by C literal rules.
+     */
+    std::unique_ptr<HashNode> literal(void);
+
+    /**
+     * @brief Parsed source string.
+     */
+    std::string text;
+
+    /**
+     * @brief Position of next unread character.
+     */
+    size_t pos = 0;
+
+    /**
+     * @brief Current nesting depth of parsed expression.
+     */
+    int depth = 0;
+
+    /**
+     * @brief Kind of current token.
+     */
+    Token tok = Token::End;
+
+    /**
+     * @brief Text of current token.
+     */
+    std::string tok_text;
+};
+
+/**
+ * @brief Create binary node with result type derived from operands.
+ * @param [in] op Binary operation.
+ * @param [in] lhs Left operand.
+ * @param [in] rhs Right operand.
+ * @return Created node.
+ */
+std::unique_ptr<HashNode> makeBinary(HashOp op, std::unique_ptr<HashNode> lhs,
+                                     std::unique_ptr<HashNode> rhs);
+
+/**
+ * @brief Create unary node.
+ * @param [in] op Unary operation.
+ * @param [in] operand Operand of operation.
+ * @return Created node.
+ */
+std::unique_ptr<HashNode> makeUnary(HashOp op,
+                                    std::unique_ptr<HashNode> operand);
+
+/**
+ * @brief Create constant node.
+ * @param [in] type Type of constant.
+ * @param [in] value Value of constant, converted to canonical form.
+ * @return Created node.
+ */
+std::unique_ptr<HashNode> makeConst(HashType type, uint64_t value);
+
+/**
+ * @brief Evaluate single operation on canonical values.
+ * @details Shared by HashVM interpreter and constant folding, so all backends
+ * use the same semantics. Shift counts are masked to operand width.
+ * @param [in] op Operation to be evaluated.
+ * @param [in] type Type of operation (common type of operands).
+ * @param [in] a Left (or only) operand.
+ * @param [in] b Right operand.
+ * @return Result in canonical form.
+ * @exception hashArithmeticError Division by zero.
+ */
+uint64_t applyOp(HashOp op, HashType type, uint64_t a, uint64_t b = 0);
+
+/**
+ * @brief Try to evaluate node as constant expression.
+ * @param [in] n Evaluated node.
+ * @param [out] value Canonical value of constant expression.
+ * @return True if node does not depend on any variable and can be evaluated
+ * without error.
+ */
+bool constantValue(const HashNode &n, uint64_t &value);
+
+/**
+ * @brief Canonical form of hash function.
+ * @details Functions which differ only in order of operands of commutative
+ * operators, parentheses, double negation, self-cancelling operations
+ * (x ^ x, x - x), idempotent ones (x & x, x | x), constant subexpressions
+ * (magic is substituted) or statements overwritten before use have the same
+ * canonical form. Rewrites never remove operations which may divide by zero,
+ * so equal canonical forms always compute equal hash values. Used as key of
+ * fitness cache.
+ * @param [in] src String representation of generated function.
+ * @param [in] magic Value of magic constant.
+ * @return Canonical form, not valid source of hash function.
+ * @exception hashCompileError Function uses unsupported construct or is
+ * not valid.
+ */
+std::string canonicalForm(const std::string &src, uint64_t magic);
+
+/**
+ * @brief Key of fitness cache for hash function.
+ * @param [in] src String representation of generated function.
+ * @param [in] magic Value of magic constant.
+ * @return Canonical form of function, or src itself if it cannot be parsed.
+ * Canonical forms never contain '=', so they do not collide with sources.
+ */
+std::string canonicalKey(const std::string &src, uint64_t magic);
+
+/**
+ * @brief Static estimate of cost of hash function.
+ */
+struct HashCost {
+    /**
+     * @brief Number of operations executed per key.
+     */
+    size_t operations = 0;
+
+    /**
+     * @brief Latency of longest dependency chain in cycles.
+     */
+    double latency = 0.0;
+
+    /**
+     * @brief Estimated cycles per key.
+     * @details Hash of single key takes at least latency of dependency
+     * chain, independent keys are limited by issue width of 4 operations
+     * per cycle.
+     * @return Lower bound of cycles per key.
+     */
+    double cycles(void) const {
+        return std::max(latency, static_cast<double>(operations) / 4.0);
+    };
+};
+
+/**
+ * @brief Estimate cost of hash function.
+ * @details Cost is computed on canonical form (see canonicalForm), so
+ * constant subexpressions and statements without effect are free.
+ * Multiplication takes 3 cycles, division and modulo 25 cycles, other
+ * operations 1 cycle.
+ * @param [in] src String representation of generated function.
+ * @param [in] magic Value of magic constant.
+ * @return Cost of function.
+ * @exception hashCompileError Function uses unsupported construct or is
+ * not valid.
+ */
+HashCost hashCost(const std::string &src, uint64_t magic);
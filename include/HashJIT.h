@@ -0,0 +1,112 @@
+/**
+ * @file HashJIT.h
+ * @author Adam Freiberg (xfreib00@stud.fit.vutbr.cz)
+ * @brief Header file for HashJIT class
+ * @version 0.1
+ * @date 2021-07-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include "HashVM.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Just-in-time compiler of generated hash functions for x86-64.
+ * @details Bytecode of HashVM is translated into straight-line machine code
+ * wrapped in loop over all words of key, so whole key is hashed by single
+ * native call. Stack slots of bytecode are mapped to registers. Programs
+ * using division or needing more registers than available are rejected and
+ * HashVM should be used instead. On other architectures compilation always
+ * fails.
+ */
+class HashJIT {
+
+  public:
+    /**
+     * @brief Type of compiled function.
+     * @details Function takes pointer to first word of key, number of words
+     * and value of magic constant and returns 64-bit hash value.
+     */
+    using Function = uint64_t (*)(const uint32_t *, size_t, uint64_t);
+
+    /**
+     * @brief Default constructor.
+     */
+    HashJIT() = default;
+
+    HashJIT(const HashJIT &) = delete;
+    HashJIT &operator=(const HashJIT &) = delete;
+
+    /**
+     * @brief Compile bytecode to native code.
+     * @param [in] vm HashVM with compiled program.
+     * @return True if program was compiled, false if it contains construct
+     * JIT can not handle.
+     * @exception std::bad_alloc Executable memory could not be allocated.
+     */
+    bool compile(const HashVM &vm);
+
+    /**
+     * @brief Calculate hash value of key using compiled function.
+     * @param [in] key Pointer to first word of key.
+     * @param [in] words Number of words in key.
+     * @param [in] magic Value of magic constant.
+     * @return Calculated 64-bit hash value.
+     */
+    uint64_t run(const uint32_t *key, size_t words, uint64_t magic) const {
+        return func(key, words, magic);
+    };
+
+    /**
+     * @brief Get compiled function.
+     * @return Pointer to native function, nullptr if nothing is compiled.
+     */
+    Function function(void) const { return func; };
+
+    /**
+     * @brief Check if JIT is supported on current platform.
+     * @return True on x86-64.
+     */
+    static constexpr bool supported(void) {
+#if defined(__x86_64__)
+        return true;
+#else
+        return false;
+#endif
+    };
+
+    /**
+     * @brief Destructor releasing executable memory.
+     */
+    ~HashJIT();
+
+  private:
+    /**
+     * @brief Translate bytecode to machine code.
+     * @param [in] vm HashVM with compiled program.
+     * @param [out] out Buffer for machine code.
+     * @return True on success.
+     */
+    static bool translate(const HashVM &vm, std::vector<uint8_t> &out);
+
+    /**
+     * @brief Executable memory page(s).
+     */
+    void *mem = nullptr;
+
+    /**
+     * @brief Size of executable memory.
+     */
+    size_t mem_size = 0;
+
+    /**
+     * @brief Pointer to compiled function.
+     */
+    Function func = nullptr;
+};
@@ -0,0 +1,123 @@
+/**
+ * @file HashReducer.h
+ * @author Adam Freiberg (xfreib00@stud.fit.vutbr.cz)
+ * @brief Header file for HashReducer class
+ * @version 0.1
+ * @date 2021-07-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include "error/hashError.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Reduction of 64-bit hash value to index of table of given size.
+ * @details Used for evaluating single hash function for multiple table sizes
+ * at once. Supported reductions are xor-folding (same as HTable), modulo
+ * prime and multiply-shift (Fibonacci hashing).
+ */
+class HashReducer {
+
+  public:
+    /**
+     * @brief Kind of reduction.
+     */
+    enum class Kind {
+        /// ((hash >> bits) ^ hash) & (2^bits - 1)
+        Fold,
+        /// hash % prime
+        Prime,
+        /// (hash * 2^64 / phi) >> (64 - bits)
+        MulShift
+    };
+
+    /**
+     * @brief Constructor of HashReducer class.
+     * @param [in] kind Kind of reduction.
+     * @param [in] param Number of index bits (1 to 32) for Fold and MulShift,
+     * prime modulus lower than 2^32 for Prime.
+     * @exception hashReducerError Parameter is out of range.
+     */
+    HashReducer(Kind kind, uint64_t param);
+
+    /**
+     * @brief Parse comma separated list of reductions.
+     * @details Each reduction is written as "fold:BITS", "prime:P" or
+     * "mulshift:BITS", e.g. "fold:12,fold:16,prime:65521".
+     * @param [in] spec List of reductions.
+     * @return Parsed reductions in given order.
+     * @exception hashReducerError Invalid list.
+     */
+    static std::vector<HashReducer> parseList(const std::string &spec);
+
+    /**
+     * @brief Reduce hash value to table index.
+     * @param [in] hash 64-bit hash value.
+     * @return Index lower than HashReducer::size.
+     */
+    uint32_t operator()(uint64_t hash) const {
+        switch (kind) {
+        case Kind::Fold:
+            return static_cast<uint32_t>(((hash >> shift) ^ hash) & mask);
+        case Kind::Prime:
+            return static_cast<uint32_t>(hash % param);
+        case Kind::MulShift:
+            return static_cast<uint32_t>((hash * 0x9E3779B97F4A7C15ull) >>
+                                         (64 - shift));
+        }
+        return 0;
+    };
+
+    /**
+     * @brief Get number of table indexes.
+     * @return Size of table.
+     */
+    size_t size(void) const { return table_size; };
+
+    /**
+     * @brief Get name of reduction used in output.
+     * @return Name such as "fold16" or "prime65521".
+     */
+    std::string name(void) const;
+
+    /**
+     * @brief Get reduction as C expression.
+     * @details Used by HashExporter, expression is valid in both C and C++.
+     * @param [in] hash Name of uint64_t variable holding hash value.
+     * @return Expression of type uint64_t computing index.
+     */
+    std::string expression(const std::string &hash) const;
+
+  private:
+    /**
+     * @brief Kind of reduction.
+     */
+    Kind kind;
+
+    /**
+     * @brief Parameter given to constructor.
+     */
+    uint64_t param;
+
+    /**
+     * @brief Number of index bits for Fold and MulShift.
+     */
+    unsigned shift = 0;
+
+    /**
+     * @brief Mask of index bits for Fold.
+     */
+    uint64_t mask = 0;
+
+    /**
+     * @brief Number of table indexes.
+     */
+    size_t table_size;
+};
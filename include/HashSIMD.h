@@ -0,0 +1,104 @@
+/**
+ * @file HashSIMD.h
+ * @author Adam Freiberg (xfreib00@stud.fit.vutbr.cz)
+ * @brief Header file for HashSIMD class
+ * @version 0.1
+ * @date 2021-07-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include "HashVM.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Vectorized evaluation of generated hash functions.
+ * @details Every key is hashed by the same sequence of operations, so
+ * HashSIMD runs bytecode of HashVM over block of HashSIMD::lanes keys at
+ * once. Block of keys is transposed so that each word is stored
+ * contiguously for all keys, and each bytecode instruction is applied to all
+ * lanes by single loop, which compiler turns into vector instructions.
+ * Instruction dispatch is therefore paid once per block instead of once per
+ * key. Kernel is compiled for AVX-512, AVX2 and generic x86-64 and the best
+ * variant supported by CPU is selected at runtime.
+ */
+class HashSIMD {
+
+  public:
+    /**
+     * @brief Number of keys hashed in lockstep.
+     */
+    static constexpr size_t lanes = 16;
+
+    /**
+     * @brief Maximal number of words in hashed key.
+     */
+    static constexpr size_t max_words = 64;
+
+    /**
+     * @brief Constructor selecting kernel for current CPU.
+     */
+    HashSIMD();
+
+    /**
+     * @brief Take over compiled program of HashVM.
+     * @param [in] vm HashVM with compiled program.
+     */
+    void compile(const HashVM &vm);
+
+    /**
+     * @brief Calculate hash values of multiple keys.
+     * @details Keys are stored one after another, key i starts at
+     * keys[i * words]. Results are identical to HashVM::run called for each
+     * key.
+     * @param [in] keys Pointer to first word of first key.
+     * @param [in] count Number of keys.
+     * @param [in] words Number of words in each key, at most
+     * HashSIMD::max_words.
+     * @param [in] magic Value of magic constant.
+     * @param [out] out Array of count calculated 64-bit hash values.
+     * @exception hashArithmeticError Division by zero.
+     */
+    void run(const uint32_t *keys, size_t count, size_t words, uint64_t magic,
+             uint64_t *out) const;
+
+    /**
+     * @brief Check if any function was compiled.
+     * @return True if no program is loaded.
+     */
+    bool empty(void) const { return code.empty(); };
+
+    /**
+     * @brief Get name of instruction set used by selected kernel.
+     * @return "avx512", "avx2" or "generic".
+     */
+    const char *isa(void) const { return isa_name; };
+
+    /**
+     * @brief Type of kernel hashing block of HashSIMD::lanes keys.
+     */
+    using Kernel = void (*)(const std::vector<HashVM::Instr> &,
+                            const uint32_t *, size_t, uint64_t, uint64_t *,
+                            uint64_t *);
+
+  private:
+    /**
+     * @brief Compiled bytecode.
+     */
+    std::vector<HashVM::Instr> code;
+
+    /**
+     * @brief Kernel selected for current CPU.
+     */
+    Kernel kernel;
+
+    /**
+     * @brief Name of instruction set used by kernel.
+     */
+    const char *isa_name;
+};
@@ -0,0 +1,207 @@
+/**
+ * @file HashVM.h
+ * @author Adam Freiberg (xfreib00@stud.fit.vutbr.cz)
+ * @brief Header file for HashVM class
+ * @version 0.1
+ * @date 2021-07-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include "HashExpr.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Bytecode interpreter for generated hash functions.
+ * @details Phenotype is compiled once into compact stack bytecode, where
+ * right operand of binary operation may be taken directly from variable or
+ * immediate value instead of stack. Compiled program is immutable, so
+ * single instance can be run from multiple threads.
+ */
+class HashVM {
+
+  public:
+    /**
+     * @brief Maximal stack depth of compiled program.
+     */
+    static constexpr size_t max_stack = 256;
+
+    /**
+     * @brief Default constructor.
+     */
+    HashVM() = default;
+
+    /**
+     * @brief Compile given hash function.
+     * @param [in] func String representation of generated function.
+     * @exception hashCompileError Function can not be compiled.
+     */
+    void compile(const std::string &func);
+
+    /**
+     * @brief Compile already parsed hash function.
+     * @param [in] ast Expression trees of function statements.
+     * @exception hashCompileError Function can not be compiled.
+     */
+    void compile(const HashAst &ast);
+
+    /**
+     * @brief Calculate hash value of key.
+     * @details Compiled function is applied to each 32-bit word of key in
+     * order, starting with hash value 0.
+     * @param [in] key Pointer to first word of key.
+     * @param [in] words Number of words in key.
+     * @param [in] magic Value of magic constant.
+     * @return Calculated 64-bit hash value.
+     * @exception hashArithmeticError Division by zero.
+     */
+    uint64_t run(const uint32_t *key, size_t words, uint64_t magic) const;
+
+    /**
+     * @brief Check if any function was compiled.
+     * @return True if no program is loaded.
+     */
+    bool empty(void) const { return code.empty(); };
+
+    /**
+     * @brief Default destructor.
+     */
+    ~HashVM() = default;
+
+    /**
+     * @brief Bytecode operations.
+     */
+    enum class Op : uint8_t {
+        Push,
+        Store,
+        Not,
+        Neg,
+        Trunc,
+        Sext,
+        Add,
+        Sub,
+        Mul,
+        DivU,
+        DivS,
+        ModU,
+        ModS,
+        And,
+        Or,
+        Xor,
+        Shl,
+        Shr,
+        Sar
+    };
+
+    /**
+     * @brief Source of instruction operand.
+     */
+    enum class Src : uint8_t { None, Stack, Imm, Hash, Key, Magic };
+
+    /**
+     * @brief Single bytecode instruction.
+     */
+    struct Instr {
+        /**
+         * @brief Executed operation.
+         */
+        Op op;
+
+        /**
+         * @brief Source of (right) operand.
+         */
+        Src src;
+
+        /**
+         * @brief Mask applied to shift count.
+         */
+        uint8_t mask;
+
+        /**
+         * @brief Immediate operand.
+         */
+        uint64_t imm;
+    };
+
+    /**
+     * @brief Execute division or modulo instruction.
+     * @details Minimal signed value divided by -1 wraps around instead of
+     * trapping.
+     * @param [in] op One of DivU, DivS, ModU and ModS.
+     * @param [in] a Dividend.
+     * @param [in] b Divisor.
+     * @return Result of operation.
+     * @exception hashArithmeticError Division by zero.
+     */
+    [[gnu::noinline]] static uint64_t divide(Op op, uint64_t a, uint64_t b);
+
+    /**
+     * @brief Get compiled program.
+     * @return Reference to bytecode, used by other backends.
+     */
+    const std::vector<Instr> &program(void) const { return code; };
+
+    /**
+     * @brief Get maximal stack depth of compiled program.
+     * @return Number of stack slots needed to run program.
+     */
+    size_t depth(void) const { return max_depth; };
+
+    /**
+     * @brief Get type of value stored to hash by last statement.
+     * @return Result type of compiled program, 32-bit result is extended
+     * to 64 bits by its signedness.
+     */
+    HashType resultType(void) const { return result_type; };
+
+  private:
+    /**
+     * @brief Emit code pushing value of node on stack.
+     * @param [in] n Node to be compiled.
+     */
+    void emit(const HashNode &n);
+
+    /**
+     * @brief Emit conversion of stack top between types.
+     * @param [in] from Type of value on stack.
+     * @param [in] to Target type.
+     */
+    void convert(HashType from, HashType to);
+
+    /**
+     * @brief Append instruction and track stack depth.
+     * @param [in] op Operation.
+     * @param [in] src Source of operand.
+     * @param [in] imm Immediate operand.
+     * @param [in] mask Shift count mask.
+     */
+    void append(Op op, Src src = Src::None, uint64_t imm = 0,
+                uint8_t mask = 0);
+
+    /**
+     * @brief Compiled bytecode.
+     */
+    std::vector<Instr> code;
+
+    /**
+     * @brief Current stack depth during compilation.
+     */
+    size_t cur_depth = 0;
+
+    /**
+     * @brief Maximal stack depth of compiled program.
+     */
+    size_t max_depth = 0;
+
+    /**
+     * @brief Result type of compiled program.
+     */
+    HashType result_type = HashType::UInt64;
+};
+
@@ -0,0 +1,44 @@
+/**
+ * @file cacheError.h
+ * @author Adam Freiberg (xfreib00@stud.fit.vutbr.cz)
+ * @brief Header file for GEPersistentCache exceptions
+ * @version 0.1
+ * @date 2021-07-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include "GEHashError.h"
+
+/**
+ * @brief Standard exception for GEPersistentCache.
+ */
+class cacheError : public GEHashError {
+  public:
+    const char *what() const throw() {
+        return "Error occured while using GEPersistentCache class.";
+    }
+};
+
+/**
+ * @brief GEPersistentCache open file exception.
+ */
+class cacheOpenError : public cacheError {
+  public:
+    const char *what() const throw() {
+        return "GEPersistentCache: Could not open given cache file.";
+    }
+};
+
+/**
+ * @brief GEPersistentCache read or write exception.
+ */
+class cacheIOError : public cacheError {
+  public:
+    const char *what() const throw() {
+        return "GEPersistentCache: Could not read or write cache file.";
+    }
+};
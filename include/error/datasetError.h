@@ -0,0 +1,44 @@
+/**
+ * @file datasetError.h
+ * @author Adam Freiberg (xfreib00@stud.fit.vutbr.cz)
+ * @brief Header file for GEDataset exceptions
+ * @version 0.1
+ * @date 2021-07-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#pragma once
+
+#include "GEHashError.h"
+
+/**
+ * @brief Standard exception for GEDataset.
+ */
+class datasetError : public GEHashError {
+  public:
+    const char *what() const throw() {
+        return "Error occured while using GEDataset class.";
+    }
+};
+
+/**
+ * @brief GEDataset open file exception.
+ */
+class datasetOpenError : public datasetError {
+  public:
+    const char *what() const throw() {
+        return "GEDataset: Could not open given training data file.";
+    }
+};
+
+/**
+ * @brief GEDataset file format exception.
+ */
+class datasetFormatError : public datasetError {
+  public:
+    const char *what() const throw() {
+        return "GEDataset: Training data file has invalid format.";
+    }
+};
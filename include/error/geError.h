@@ -63,6 +63,72 @@ class geGenerationError : public geError {
     }
 };
 
+/**
+ * @brief Number of threads exception.
+ */
+class geThreadsError : public geError {
+  public:
+    const char *what() const throw() {
+        return "Number of threads is out of range. Must be at least 1.";
+    }
+};
+
+/**
+ * @brief Hash table size exception.
+ */
+class geBitsError : public geError {
+  public:
+    const char *what() const throw() {
+        return "Unsupported number of table index bits. Must be 12, 16, 20 "
+               "or 24.";
+    }
+};
+
+/**
+ * @brief Evaluation stages exception.
+ */
+class geStagesError : public geError {
+  public:
+    const char *what() const throw() {
+        return "Invalid stages. Must be list of FRACTION:THRESHOLD with "
+               "fraction between 0 and 1 and positive threshold.";
+    }
+};
+
+/**
+ * @brief Cutoff exception.
+ */
+class geCutoffError : public geError {
+  public:
+    const char *what() const throw() {
+        return "Invalid cutoff. Must be none, worst, tournament or "
+               "non-negative number.";
+    }
+};
+
+/**
+ * @brief Island model exception.
+ */
+class geIslandsError : public geError {
+  public:
+    const char *what() const throw() {
+        return "Invalid islands. Number of islands must be more than 0 and "
+               "migration must be TOPOLOGY:INTERVAL:MIGRANTS with ring or "
+               "full topology and positive interval.";
+    }
+};
+
+/**
+ * @brief Quality metrics exception.
+ */
+class geQualityError : public geError {
+  public:
+    const char *what() const throw() {
+        return "Invalid quality. Must be log or AVALANCHE:CHI2:MAX_LOAD "
+               "non-negative weights, optionally followed by :KEYS.";
+    }
+};
+
 /**
  * @brief Grammar string exception.
  */
@@ -57,4 +57,44 @@ class hashSearchError : public hashTableError {
 class hashFuncError : public hashTableError {
   public:
     const char *what() const throw() { return "Hash function not specified"; }
-};
\ No newline at end of file
+};
+/**
+ * @brief Exception for HashParser and HashVM compilation.
+ */
+class hashCompileError : public hashTableError {
+  public:
+    const char *what() const throw() {
+        return "Hash function could not be compiled.";
+    }
+};
+
+/**
+ * @brief Exception for HashVM arithmetic errors.
+ */
+class hashArithmeticError : public hashTableError {
+  public:
+    const char *what() const throw() {
+        return "Arithmetic error while evaluating hash function.";
+    }
+};
+
+/**
+ * @brief Exception for invalid hash value reduction.
+ */
+class hashReducerError : public hashTableError {
+  public:
+    const char *what() const throw() {
+        return "Invalid table reduction. Use fold:BITS, mulshift:BITS (BITS "
+               "from 1 to 32) or prime:P (P prime lower than 2^32).";
+    }
+};
+
+/**
+ * @brief Exception for failed export of hash function.
+ */
+class hashExportError : public hashTableError {
+  public:
+    const char *what() const throw() {
+        return "Exported hash function could not be written.";
+    }
+};
@@ -0,0 +1,233 @@
+/**
+ * @file GEDataset.cpp
+ * @author Adam Freiberg (xfreib00@stud.fit.vutbr.cz)
+ * @brief Source file for GEDataset class methods
+ * @version 0.1
+ * @date 2021-07-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include "GEDataset.h"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* identification of binary training data file */
+static constexpr char file_magic[8] = {'G', 'E', 'H', 'A', 'S', 'H', 'D', 'S'};
+
+static_assert(sizeof(GEDataset::Header) == 32,
+              "binary header must not contain padding");
+static_assert(sizeof(GEDataset::Key) == 36, "keys must be packed");
+
+GEDataset::GEDataset(const std::string &path) { load(path); }
+
+GEDataset::GEDataset(const GEDataset &source, double fraction) {
+    const double wanted = static_cast<double>(source.size()) * fraction;
+    const size_t n = std::min(
+        source.size(), std::max<size_t>(static_cast<size_t>(wanted), 1));
+    keys.reserve(n);
+    for (size_t i = 0; i < n && !source.empty(); i++) {
+        /* middle of i-th stratum */
+        keys.push_back(source.first[(2 * i + 1) * source.size() / (2 * n)]);
+    }
+    first = keys.data();
+    count = keys.size();
+    d_path = source.d_path;
+}
+
+GEDataset::~GEDataset() { clear(); }
+
+uint64_t GEDataset::fingerprint(void) const {
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (const Key &key : *this) {
+        for (const uint32_t word : key) {
+            h = (h ^ word) * 0x100000001b3ull;
+        }
+    }
+    return h;
+}
+
+void GEDataset::clear(void) {
+    if (map != nullptr) {
+        munmap(map, map_size);
+        map = nullptr;
+        map_size = 0;
+    }
+    keys.clear();
+    keys.shrink_to_fit();
+    first = nullptr;
+    count = 0;
+}
+
+void GEDataset::load(const std::string &path) {
+    auto start = std::chrono::steady_clock::now();
+
+    clear();
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw datasetOpenError();
+    }
+
+    /* detect binary format by its magic */
+    char magic[sizeof(file_magic)] = {};
+    const bool binary = pread(fd, magic, sizeof(magic), 0) ==
+                            static_cast<ssize_t>(sizeof(magic)) &&
+                        std::memcmp(magic, file_magic, sizeof(magic)) == 0;
+
+    try {
+        if (binary) {
+            loadBinary(fd);
+        } else {
+            loadText(path);
+        }
+    } catch (...) {
+        close(fd);
+        clear();
+        throw;
+    }
+    close(fd);
+
+    d_path = path;
+    load_time = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+}
+
+void GEDataset::loadBinary(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        throw datasetOpenError();
+    }
+    const auto size = static_cast<size_t>(st.st_size);
+
+    Header h;
+    if (size < sizeof(Header) ||
+        pread(fd, &h, sizeof(h), 0) != static_cast<ssize_t>(sizeof(h))) {
+        throw datasetFormatError();
+    }
+
+    /* reject other versions and files which do not match their header */
+    if (h.version != format_version ||
+        h.key_words != std::tuple_size<Key>::value ||
+        h.count > (size - sizeof(Header)) / sizeof(Key) ||
+        size != sizeof(Header) + h.count * sizeof(Key)) {
+        throw datasetFormatError();
+    }
+
+    if (h.count == 0) {
+        return;
+    }
+
+    void *m = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (m == MAP_FAILED) {
+        throw datasetOpenError();
+    }
+    /* whole file is read by each evaluation, start reading it ahead */
+    madvise(m, size, MADV_WILLNEED);
+
+    map = m;
+    map_size = size;
+    first = reinterpret_cast<const Key *>(static_cast<const char *>(m) +
+                                          sizeof(Header));
+    count = h.count;
+}
+
+void GEDataset::loadText(const std::string &path) {
+    /* read whole file at once */
+    std::ifstream f(path, std::ios::in | std::ios::binary);
+    if (!f) {
+        throw datasetOpenError();
+    }
+    std::string content((std::istreambuf_iterator<char>(f)),
+                        std::istreambuf_iterator<char>());
+
+    /* lines have at least 20 characters, reserve upper bound of keys */
+    keys.reserve(content.size() / 20 + 1);
+
+    const char *p = content.data();
+    const char *end = p + content.size();
+    while (p < end) {
+        const void *nl = std::memchr(p, '\n', static_cast<size_t>(end - p));
+        const char *eol = nl ? static_cast<const char *>(nl) : end;
+
+        /* skip empty lines */
+        if (eol != p && !(eol - p == 1 && *p == '\r')) {
+            Key key;
+            if (!parseLine(p, eol, key)) {
+                throw datasetFormatError();
+            }
+            keys.push_back(key);
+        }
+        p = eol + 1;
+    }
+    keys.shrink_to_fit();
+
+    first = keys.data();
+    count = keys.size();
+}
+
+void GEDataset::save(const std::string &path) const {
+    const std::string tmp = path + ".tmp";
+
+    Header h = {};
+    std::memcpy(h.magic, file_magic, sizeof(file_magic));
+    h.version = format_version;
+    h.key_words = std::tuple_size<Key>::value;
+    h.count = count;
+
+    std::ofstream out(tmp, std::ios::out | std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+    if (count > 0) {
+        out.write(reinterpret_cast<const char *>(first),
+                  static_cast<std::streamsize>(bytes()));
+    }
+    out.close();
+
+    if (!out || std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        throw datasetOpenError();
+    }
+}
+
+bool GEDataset::parseLine(const char *line, const char *eol, Key &key) {
+    /* 8 address words and 2 ports */
+    std::array<uint64_t, 10> fields;
+    size_t n = 0;
+
+    while (line < eol && n < fields.size()) {
+        /* skip separators, empty fields are ignored */
+        if (*line == ';' || *line == ' ' || *line == '\r') {
+            line++;
+            continue;
+        }
+        auto [ptr, ec] = std::from_chars(line, eol, fields[n]);
+        if (ec != std::errc()) {
+            return false;
+        }
+        line = ptr;
+        n++;
+    }
+
+    if (n != fields.size()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < 8; i++) {
+        key[i] = static_cast<uint32_t>(fields[i]);
+    }
+    key[8] = static_cast<uint32_t>(fields[8]) << 16;
+    key[8] |= static_cast<uint32_t>(fields[9]);
+
+    return true;
+}
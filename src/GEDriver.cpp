@@ -0,0 +1,277 @@
+/**
+ * @file GEDriver.cpp
+ * @author Adam Freiberg (xfreib00@stud.fit.vutbr.cz)
+ * @brief Source file for GEDriver class methods
+ * @version 0.1
+ * @date 2021-07-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include "GEDriver.h"
+#include "HashExpr.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <sys/resource.h>
+
+GEDriver::GEDriver(std::unique_ptr<gram::Mapper> mapper,
+                   std::vector<std::unique_ptr<GEEvaluatorBase>> evaluators)
+    : mapper(std::move(mapper)), evaluators(std::move(evaluators)),
+      pool(this->evaluators.size()) {
+    //
+}
+
+void GEDriver::setCutoff(CutoffMode mode, gram::Fitness value,
+                         unsigned long tournament) {
+    cutoff_mode = mode;
+    cutoff_value = value;
+    this->tournament = std::max(tournament, 2ul);
+}
+
+std::string GEDriver::cacheKey(const gram::Phenotype &phenotype) const {
+    return canonical ? canonicalKey(phenotype, magic) : phenotype;
+}
+
+double GEDriver::phenotypeCost(const gram::Phenotype &phenotype,
+                               const std::string &key) {
+    if (auto it = costs.find(key); it != costs.end()) {
+        return it->second;
+    }
+    double c = std::numeric_limits<double>::infinity();
+    try {
+        c = hashCost(phenotype, magic).cycles();
+    } catch (hashCompileError &e) {
+        /* fitness of such phenotype is failure as well */
+    }
+    costs.emplace(key, c);
+    return c;
+}
+
+gram::Fitness GEDriver::currentCutoff(void) {
+    if (cutoff_mode == CutoffMode::Value) {
+        return cutoff_value;
+    }
+    if (cutoff_mode == CutoffMode::None || previous.empty()) {
+        return std::numeric_limits<gram::Fitness>::infinity();
+    }
+
+    std::sort(previous.begin(), previous.end());
+    if (cutoff_mode == CutoffMode::Worst) {
+        return previous.back();
+    }
+
+    /* individual worse than fraction q of population wins tournament of
+     * size t with probability (1 - q)^(t - 1), find q for which it is 1% */
+    const double q =
+        1.0 - std::pow(0.01, 1.0 / static_cast<double>(tournament - 1));
+    const auto i = static_cast<size_t>(
+        std::ceil(q * static_cast<double>(previous.size() - 1)));
+    return previous[std::min(i, previous.size() - 1)];
+}
+
+void GEDriver::evaluate(gram::Individuals &individuals) {
+    constexpr gram::Fitness failed = std::numeric_limits<gram::Fitness>::max();
+    const gram::Fitness cutoff = currentCutoff();
+
+    /* phenotypes waiting for evaluation and their results */
+    std::vector<gram::Phenotype> pending;
+    std::vector<gram::Fitness> results;
+    std::vector<char> truncated;
+    /* index into pending for each individual, npos if fitness is known */
+    constexpr size_t npos = std::numeric_limits<size_t>::max();
+    std::vector<size_t> slot(individuals.size(), npos);
+    std::unordered_map<std::string, size_t> queued;
+    std::vector<std::string> keys;
+
+    GEStats current;
+    current.individuals = individuals.size();
+    current.cutoff = cutoff;
+    previous.clear();
+
+    /* time since previous call, clock is not read when timing is off */
+    using Clock = std::chrono::steady_clock;
+    const bool timed = timing && stats;
+    Clock::time_point mark = timed ? Clock::now() : Clock::time_point();
+    auto lap = [&](void) {
+        if (!timed) {
+            return 0.0;
+        }
+        const auto now = Clock::now();
+        const double d = std::chrono::duration<double>(now - mark).count();
+        mark = now;
+        return d;
+    };
+    size_t hashed = 0;
+    if (timed) {
+        for (const auto &e : evaluators) {
+            hashed += e->keysHashed();
+        }
+    }
+
+    /* results of other runs */
+    if (persistent) {
+        try {
+            current.loaded = persistent->load(cache);
+        } catch (cacheError &e) {
+            std::cerr << e.what() << std::endl;
+            persistent.reset();
+        }
+    }
+
+    /* second objective, unmapped individuals have infinite cost, only
+     * completely evaluated individuals may enter Pareto front */
+    std::vector<double> cost;
+    std::vector<char> exact_fitness;
+    if (pareto) {
+        cost.resize(individuals.size(),
+                    std::numeric_limits<double>::infinity());
+        exact_fitness.resize(individuals.size(), false);
+    }
+
+    for (size_t i = 0; i < individuals.size(); i++) {
+        gram::Phenotype phenotype;
+        try {
+            phenotype = mapper->map(individuals[i].genotype());
+        } catch (std::exception &e) {
+            /* genotype could not be mapped (e.g. wrapping limit reached) */
+            individuals[i].setFitness(failed);
+            continue;
+        }
+
+        std::string key = cacheKey(phenotype);
+        if (pareto) {
+            cost[i] = phenotypeCost(phenotype, key);
+        }
+        if (auto it = cache.find(key); it != cache.end()) {
+            individuals[i].setFitness(it->second);
+            current.cache_hits++;
+            const bool is_exact = !estimated.count(key);
+            if (it->second != failed && is_exact) {
+                previous.push_back(it->second);
+            }
+            if (pareto) {
+                exact_fitness[i] = is_exact;
+            }
+            continue;
+        }
+
+        /* evaluate each distinct phenotype only once */
+        auto [it, inserted] = queued.emplace(key, pending.size());
+        if (inserted) {
+            pending.push_back(std::move(phenotype));
+            keys.push_back(std::move(key));
+        } else {
+            current.duplicates++;
+        }
+        slot[i] = it->second;
+    }
+
+    current.time.map = lap();
+    results.resize(pending.size());
+    truncated.resize(pending.size());
+    /* phenotypes discarded by staged evaluation */
+    std::vector<char> discarded(pending.size());
+
+    /* phenotypes still competing, evaluated on growing samples */
+    std::vector<size_t> alive(pending.size());
+    std::iota(alive.begin(), alive.end(), 0);
+    for (size_t s = 0; s < stages.size() && !alive.empty(); s++) {
+        std::vector<gram::Fitness> ratios(alive.size());
+        pool.run(alive.size(), [&](size_t task, size_t worker) {
+            ratios[task] =
+                evaluators[worker]->evaluateStage(pending[alive[task]], s);
+        });
+
+        const gram::Fitness random = evaluators[0]->randomFitness();
+        std::vector<size_t> promoted;
+        for (size_t k = 0; k < alive.size(); k++) {
+            const size_t i = alive[k];
+            if (ratios[k] <= stages[s].threshold) {
+                promoted.push_back(i);
+                continue;
+            }
+            discarded[i] = true;
+            results[i] = ratios[k] == failed ? failed : ratios[k] * random;
+        }
+        current.stages.push_back({stages[s].fraction, alive.size(),
+                                  promoted.size()});
+        alive = std::move(promoted);
+    }
+    current.time.stages = lap();
+
+    pool.run(alive.size(), [&](size_t task, size_t worker) {
+        const size_t i = alive[task];
+        bool t = false;
+        results[i] = evaluators[worker]->evaluateBounded(pending[i], cutoff, t);
+        truncated[i] = t;
+    });
+    current.time.evaluate = lap();
+
+    /* fitness of truncated evaluation depends on cutoff, do not cache it */
+    std::vector<std::pair<std::string, gram::Fitness>> exact;
+    for (size_t i = 0; i < pending.size(); i++) {
+        if (truncated[i]) {
+            current.truncated++;
+            continue;
+        }
+        if (discarded[i]) {
+            estimated.insert(keys[i]);
+        } else if (persistent) {
+            exact.emplace_back(keys[i], results[i]);
+        }
+        cache.emplace(std::move(keys[i]), results[i]);
+    }
+
+    if (persistent) {
+        try {
+            persistent->append(exact);
+        } catch (cacheError &e) {
+            std::cerr << e.what() << std::endl;
+            persistent.reset();
+        }
+    }
+    current.evaluated = alive.size();
+
+    for (size_t i = 0; i < individuals.size(); i++) {
+        if (slot[i] == npos) {
+            continue;
+        }
+        individuals[i].setFitness(results[slot[i]]);
+        const bool is_exact = !truncated[slot[i]] && !discarded[slot[i]];
+        if (is_exact && results[slot[i]] != failed) {
+            previous.push_back(results[slot[i]]);
+        }
+        if (pareto) {
+            exact_fitness[i] = is_exact;
+        }
+    }
+
+    if (pareto) {
+        pareto->rank(individuals, cost, exact_fitness);
+    }
+
+    if (timed) {
+        current.timed = true;
+        for (const auto &e : evaluators) {
+            current.keys_hashed += e->keysHashed();
+        }
+        current.keys_hashed -= hashed;
+        current.time.total = current.time.map + current.time.stages +
+                             current.time.evaluate + lap();
+
+        /* maximal resident set size, in KiB on Linux */
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) == 0) {
+            current.peak_rss = static_cast<size_t>(usage.ru_maxrss);
+        }
+    }
+
+    if (stats) {
+        *stats = current;
+    }
+}
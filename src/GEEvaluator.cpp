@@ -10,69 +10,493 @@
  */
 
 #include "GEEvaluator.h"
+#include "error/geError.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 
-GEEvaluator::GEEvaluator(uint64_t magic, const std::string &data_path,
-                         const bool &useSum) {
+template <unsigned Bits>
+GEEvaluator<Bits>::GEEvaluator(uint64_t magic, const std::string &data_path,
+                               const bool &useSum, HashEngine engine)
+    : GEEvaluator<Bits>(magic, std::make_shared<const GEDataset>(data_path),
+                        useSum, engine) {
+    //
+}
+
+template <unsigned Bits>
+GEEvaluator<Bits>::GEEvaluator(uint64_t magic,
+                               std::shared_ptr<const GEDataset> dataset,
+                               const bool &useSum, HashEngine engine) {
     table.setMagic(magic);
-    d_path = data_path;
+    table.setEngine(engine);
+    /* fitness needs only number of keys at each index */
+    table.setCountOnly(true);
+    data = std::move(dataset);
     use_sum = useSum;
 }
 
-Fitness GEEvaluator::calculateFitness(std::string program) {
+template <unsigned Bits> void GEEvaluator<Bits>::setShards(size_t shards) {
+    if (shards < 1) {
+        throw geThreadsError();
+    }
+    if (shards == 1) {
+        shard_pool.reset();
+        shard_counts.clear();
+        shard_sum.reset();
+        return;
+    }
+    shard_pool = std::make_unique<GEThreadPool>(shards);
+    shard_sum = std::make_unique<Dimensions>(table.getSize());
+    shard_counts.assign(shards, std::vector<uint32_t>(table.getSize()));
+    allocateResolutions();
+}
+
+template <unsigned Bits>
+void GEEvaluator<Bits>::setResolutions(
+    std::vector<HashReducer> reducers,
+    std::shared_ptr<GEFitnessDetails> details) {
+    this->reducers = std::move(reducers);
+    this->details = std::move(details);
+
+    baselines.clear();
+    for (const auto &r : this->reducers) {
+        /* avoid division by zero for tiny training sets */
+        baselines.push_back(
+            std::max(expectedFitness(r.size(), data->size()), 1.0));
+    }
+    allocateResolutions();
+}
+
+template <unsigned Bits>
+void GEEvaluator<Bits>::setStages(
+    std::vector<std::shared_ptr<const GEDataset>> samples) {
+    this->samples = std::move(samples);
+
+    sample_baselines.clear();
+    for (const auto &s : this->samples) {
+        sample_baselines.push_back(
+            std::max(expectedFitness(table.getSize(), s->size()), 1.0));
+    }
+}
+
+template <unsigned Bits>
+void GEEvaluator<Bits>::setQuality(const GEQuality &q,
+                                   std::shared_ptr<GEFitnessDetails> store) {
+    quality = q;
+    quality_details = std::move(store);
+    flips.assign(sizeof(GEDataset::Key) * 8 * 64, 0);
+}
+
+template <unsigned Bits> void GEEvaluator<Bits>::allocateResolutions(void) {
+    const size_t workers = shard_pool ? shard_pool->size() : 1;
+    res_counts.assign(reducers.empty() ? 0 : workers,
+                      std::vector<Dimensions>());
+    for (auto &hist : res_counts) {
+        for (const auto &r : reducers) {
+            hist.emplace_back(r.size());
+        }
+    }
+}
+
+template <unsigned Bits>
+Fitness GEEvaluator<Bits>::expectedFitness(size_t buckets,
+                                           size_t keys) const {
+    const double m = static_cast<double>(buckets);
+    const double lambda = static_cast<double>(keys) / m;
+    /* E[c^2] over indexes with more than one key and probability of such
+     * index */
+    const double q = lambda + lambda * lambda - lambda * std::exp(-lambda);
+    const double p = 1.0 - std::exp(-lambda) * (1.0 + lambda);
+
+    if (use_sum) {
+        /* each colliding index adds sum of all preceding colliding ones */
+        return m * q + p * q * m * (m - 1.0) / 2.0;
+    }
+    return m * q;
+}
+
+template <unsigned Bits>
+Fitness GEEvaluator<Bits>::calculateFitness(std::string program) {
+    bool truncated = false;
+    return calculateFitness(program, numeric_limits<Fitness>::infinity(),
+                            truncated);
+}
+
+template <unsigned Bits>
+Fitness GEEvaluator<Bits>::calculateFitness(const std::string &program,
+                                            Fitness cutoff, bool &truncated) {
     Fitness fit = 0.0;
+    truncated = false;
 
     /* set up table for */
     table.setFunc(program);
 
-    std::array<uint16_t, numeric_limits<uint16_t>::max()> arr;
-    std::array<uint32_t, 9> keys;
-    std::vector<std::string> chunks;
+    if (!reducers.empty()) {
+        return resolutionFitness(program);
+    }
 
-    /* open file containing train data */
-    std::ifstream f(d_path);
+    if (shard_pool && table.isConcurrent()) {
+        uint64_t bound = 0;
+        size_t processed = 0;
+        if (!shardedDimensions(*data, cutoff, bound, processed)) {
+            hashed += processed;
+            truncated = true;
+            return truncatedFitness(bound, processed);
+        }
+        hashed += data->size();
+        if (use_sum) {
+            fitnessWithSum(*shard_sum, fit);
+        } else {
+            fit = static_cast<Fitness>(shard_squares);
+        }
+        return qualityFitness(program, *shard_sum, fit);
+    }
 
-    /* insert training data to hash table */
-    for (std::string line; getline(f, line);) {
+    /* insert training data to hash table, without cutoff at once */
+    const size_t step = std::isinf(cutoff) ? data->size() : abort_step;
+    for (size_t first = 0; first < data->size(); first += step) {
+        const size_t n = std::min(step, data->size() - first);
+        try {
+            table.Insert(data->begin() + first, n);
+        } catch (...) {
+            /* leave table empty for next evaluation */
+            table.clearTab();
+            throw;
+        }
+        hashed += n;
 
-        chunks = split(line, ";");
+        /* sum of squares is lower bound of both fitness functions */
+        if (static_cast<Fitness>(table.getSquares()) > cutoff) {
+            truncated = true;
+            fit = truncatedFitness(table.getSquares(), first + n);
+            table.clearTab();
+            return fit;
+        }
+    }
 
-        for (auto it = 0ul; it < keys.size(); it++) {
-            if (it > 7) {
-                keys[it] = static_cast<uint32_t>(std::stoul(chunks[it]));
-                keys[it] = keys[it] << 16;
-                keys[it] |= static_cast<uint32_t>(std::stoul(chunks[it + 1]));
+    /* fitness without sum is maintained by table during insertion */
+    if (use_sum) {
+        fitnessWithSum(table.getDimensions(), fit);
+    } else {
+        fit = static_cast<Fitness>(table.getSquares());
+    }
+
+    try {
+        fit = qualityFitness(program, table.getDimensions(), fit);
+    } catch (...) {
+        table.clearTab();
+        throw;
+    }
+
+    table.clearTab();
+
+    return fit;
+}
+
+template <unsigned Bits>
+Fitness GEEvaluator<Bits>::qualityFitness(const std::string &program,
+                                          const Dimensions &arr, Fitness fit) {
+    if (!quality) {
+        return fit;
+    }
+
+    /* chi-square of occupancy against uniform distribution and maximal
+     * load */
+    uint64_t keys = 0;
+    uint32_t max_load = 0;
+    for (const uint32_t a : arr) {
+        keys += a;
+        max_load = std::max(max_load, a);
+    }
+    const double m = static_cast<double>(arr.size());
+    const double mean = static_cast<double>(keys) / m;
+    double chi2 = 0.0;
+    if (keys > 0) {
+        for (const uint32_t a : arr) {
+            const double d = static_cast<double>(a) - mean;
+            chi2 += d * d;
+        }
+        chi2 /= mean * (m - 1.0);
+    }
+
+    /* expected maximal load of random function, the smallest load which
+     * less than one index of table exceeds (Poisson approximation) */
+    double expected_max = 1.0;
+    if (keys > 0) {
+        double tail = 1.0;
+        const double limit = mean + 10.0 * std::sqrt(mean) + 50.0;
+        for (double k = 0.0; k < limit; k += 1.0) {
+            tail -= std::exp(k * std::log(mean) - mean - std::lgamma(k + 1));
+            if (m * tail < 1.0) {
+                expected_max = std::max(k, 1.0);
                 break;
             }
-            keys[it] = static_cast<uint32_t>(std::stoul(chunks[it]));
         }
+    }
+    const double load = static_cast<double>(max_load) / expected_max;
 
-        try {
-            table.Insert(keys);
-            std::fill_n(keys.begin(), keys.size(), 0);
-        } catch (hashInsertError &e) {
-            // std::cerr << line << '\n';
-            table.clearTab();
-            throw;
+    const double bias = avalancheBias();
+
+    if (quality_details) {
+        quality_details->store(program,
+                               {bias, chi2, static_cast<Fitness>(max_load)});
+    }
+    return fit * (1.0 + quality->avalanche * bias +
+                  quality->chi2 * std::max(chi2 - 1.0, 0.0) +
+                  quality->max_load * std::max(load - 1.0, 0.0));
+}
+
+template <unsigned Bits> double GEEvaluator<Bits>::avalancheBias(void) {
+    constexpr size_t key_bits = sizeof(GEDataset::Key) * 8;
+    /* each sampled key is hashed as is and with every bit flipped */
+    constexpr size_t variants = key_bits + 1;
+    const size_t samples = std::min(quality->keys, data->size());
+    if (samples == 0) {
+        return 0.0;
+    }
+    const size_t stride = data->size() / samples;
+
+    /* result type is known from function compiled by table */
+    const unsigned out_bits = table.outputBits();
+    const size_t cells = key_bits * out_bits;
+
+    std::fill(flips.begin(), flips.end(), 0);
+    std::array<GEDataset::Key, Table::batch> keys;
+    std::array<uint64_t, Table::batch> raw;
+    uint64_t base = 0;
+    const size_t total = samples * variants;
+    for (size_t first = 0; first < total; first += keys.size()) {
+        const size_t n = std::min(keys.size(), total - first);
+        for (size_t j = 0; j < n; j++) {
+            const size_t v = (first + j) % variants;
+            keys[j] = data->begin()[(first + j) / variants * stride];
+            if (v > 0) {
+                keys[j][(v - 1) / 32] ^= uint32_t{1} << ((v - 1) % 32);
+            }
+        }
+        table.HashRaw(keys.data(), n, raw.data());
+
+        for (size_t j = 0; j < n; j++) {
+            const size_t v = (first + j) % variants;
+            if (v == 0) {
+                base = raw[j];
+                continue;
+            }
+            const uint64_t diff = raw[j] ^ base;
+            uint32_t *row = flips.data() + (v - 1) * out_bits;
+            for (unsigned o = 0; o < out_bits; o++) {
+                row[o] += (diff >> o) & 1;
+            }
+        }
+    }
+    hashed += total;
+
+    /* E[(2p - 1)^2] of ideal function is 1 / samples */
+    const double s = static_cast<double>(samples);
+    double sum = 0.0;
+    for (size_t c = 0; c < cells; c++) {
+        const double d = 2.0 * static_cast<double>(flips[c]) / s - 1.0;
+        sum += d * d;
+    }
+    const double msd = sum / static_cast<double>(cells) - 1.0 / s;
+    return std::sqrt(std::max(msd, 0.0));
+}
+
+template <unsigned Bits>
+Fitness GEEvaluator<Bits>::truncatedFitness(uint64_t bound,
+                                            size_t processed) const {
+    /* extrapolate bound to whole training set, so truncated individuals are
+     * still ordered among themselves */
+    return static_cast<Fitness>(bound) * static_cast<Fitness>(data->size()) /
+           static_cast<Fitness>(std::max<size_t>(processed, 1));
+}
+
+template <unsigned Bits>
+bool GEEvaluator<Bits>::shardedDimensions(const GEDataset &set,
+                                          Fitness cutoff, uint64_t &bound,
+                                          size_t &processed) {
+    /* more chunks than threads, so threads finishing early take over work of
+     * slower ones */
+    const size_t chunk_count = shard_pool->size() * 8;
+    const size_t chunk = (set.size() + chunk_count - 1) / chunk_count;
+    const GEDataset::Key *keys = set.begin();
+    const bool bounded = !std::isinf(cutoff);
+
+    /* sum of squares of private histograms is lower bound of sum of squares
+     * of merged one */
+    std::atomic<uint64_t> squares{0};
+    std::atomic<size_t> done{0};
+    std::atomic<bool> stop{false};
+
+    for (auto &c : shard_counts) {
+        std::fill(c.begin(), c.end(), 0);
+    }
+
+    shard_pool->run(chunk_count, [&](size_t task, size_t worker) {
+        const size_t first = std::min(task * chunk, set.size());
+        const size_t last = std::min(first + chunk, set.size());
+        auto &counts = shard_counts[worker];
+        std::array<typename Table::Index, Table::batch> hashes;
+        for (size_t i = first; i < last; i += hashes.size()) {
+            if (stop.load(std::memory_order_relaxed)) {
+                return;
+            }
+            const size_t n = std::min(hashes.size(), last - i);
+            table.Hash(keys + i, n, hashes.data());
+            uint64_t delta = 0;
+            for (size_t j = 0; j < n; j++) {
+                const uint64_t c = counts[hashes[j]]++;
+                delta += c == 0 ? 0 : (c == 1 ? 4 : 2 * c + 1);
+            }
+            if (bounded) {
+                done += n;
+                if (static_cast<Fitness>(squares += delta) > cutoff) {
+                    stop = true;
+                }
+            }
         }
+    });
+
+    if (stop) {
+        bound = squares;
+        processed = done;
+        return false;
     }
 
-    /* get counts at each index */
-    arr = table.getDimensions();
+    /* reduce private histograms, fitness without sum is computed on the
+     * way */
+    Dimensions &arr = *shard_sum;
+    uint64_t merged = 0;
+    for (size_t i = 0; i < arr.size(); i++) {
+        uint32_t sum = 0;
+        for (const auto &c : shard_counts) {
+            sum += c[i];
+        }
+        arr[i] = sum;
+        merged += sum > 1 ? uint64_t{sum} * sum : 0;
+    }
+    shard_squares = merged;
+    return true;
+}
+
+template <unsigned Bits>
+Fitness GEEvaluator<Bits>::sampleFitness(const GEDataset &set) {
+    Fitness fit = 0.0;
 
+    if (shard_pool && table.isConcurrent()) {
+        uint64_t bound = 0;
+        size_t processed = 0;
+        shardedDimensions(set, numeric_limits<Fitness>::infinity(), bound,
+                          processed);
+        hashed += set.size();
+        if (use_sum) {
+            fitnessWithSum(*shard_sum, fit);
+        } else {
+            fit = static_cast<Fitness>(shard_squares);
+        }
+        return fit;
+    }
+
+    try {
+        table.Insert(set.begin(), set.size());
+    } catch (...) {
+        /* leave table empty for next evaluation */
+        table.clearTab();
+        throw;
+    }
+    hashed += set.size();
     if (use_sum) {
-        fitnessWithSum(arr, fit);
+        fitnessWithSum(table.getDimensions(), fit);
     } else {
-        fitnessWithoutSum(arr, fit);
+        fit = static_cast<Fitness>(table.getSquares());
     }
-
     table.clearTab();
-
     return fit;
 }
 
-Fitness GEEvaluator::evaluate(const Phenotype &phenotype) noexcept {
+template <unsigned Bits>
+Fitness GEEvaluator<Bits>::resolutionFitness(const std::string &program) {
+    const bool sharded = shard_pool && table.isConcurrent();
+    const GEDataset::Key *keys = data->begin();
+
+    for (auto &hist : res_counts) {
+        for (auto &h : hist) {
+            std::fill(h.begin(), h.end(), 0);
+        }
+    }
+
+    /* hash keys once, reduce them for every table */
+    auto count = [&](size_t first, size_t last, size_t worker) {
+        std::array<uint64_t, Table::batch> raw;
+        auto &hist = res_counts[worker];
+        for (size_t i = first; i < last; i += raw.size()) {
+            const size_t n = std::min(raw.size(), last - i);
+            table.HashRaw(keys + i, n, raw.data());
+            for (size_t r = 0; r < reducers.size(); r++) {
+                const HashReducer &reduce = reducers[r];
+                auto &h = hist[r];
+                for (size_t j = 0; j < n; j++) {
+                    h[reduce(raw[j])]++;
+                }
+            }
+        }
+    };
+
+    if (sharded) {
+        const size_t chunk_count = shard_pool->size() * 8;
+        const size_t chunk = (data->size() + chunk_count - 1) / chunk_count;
+        shard_pool->run(chunk_count, [&](size_t task, size_t worker) {
+            const size_t first = std::min(task * chunk, data->size());
+            count(first, std::min(first + chunk, data->size()), worker);
+        });
+
+        /* reduce private histograms into first one */
+        for (size_t w = 1; w < res_counts.size(); w++) {
+            for (size_t r = 0; r < reducers.size(); r++) {
+                auto &dst = res_counts[0][r];
+                const auto &src = res_counts[w][r];
+                for (size_t i = 0; i < dst.size(); i++) {
+                    dst[i] += src[i];
+                }
+            }
+        }
+    } else {
+        count(0, data->size(), 0);
+    }
+    hashed += data->size();
+
+    std::vector<Fitness> parts(reducers.size(), 0.0);
+    Fitness combined = 0.0;
+    for (size_t r = 0; r < reducers.size(); r++) {
+        if (use_sum) {
+            fitnessWithSum(res_counts[0][r], parts[r]);
+        } else {
+            fitnessWithoutSum(res_counts[0][r], parts[r]);
+        }
+        combined += parts[r] / baselines[r];
+    }
+    combined = qualityFitness(program, res_counts[0][0], combined);
+
+    if (details) {
+        details->store(program, std::move(parts));
+    }
+    return combined;
+}
+
+template <unsigned Bits>
+Fitness GEEvaluator<Bits>::evaluate(const Phenotype &phenotype) noexcept {
+    bool truncated = false;
+    return evaluateBounded(phenotype, numeric_limits<Fitness>::infinity(),
+                           truncated);
+}
+
+template <unsigned Bits>
+Fitness GEEvaluator<Bits>::evaluateBounded(const Phenotype &phenotype,
+                                           Fitness cutoff,
+                                           bool &truncated) noexcept {
+    truncated = false;
     try {
-        return calculateFitness(phenotype);
+        return calculateFitness(phenotype, cutoff, truncated);
     } catch (hashInsertError &e) {
         std::cerr << "Duplicity in training data: " << e.what() << std::endl;
         return numeric_limits<Fitness>::max();
@@ -82,48 +506,60 @@ Fitness GEEvaluator::evaluate(const Phenotype &phenotype) noexcept {
     }
 }
 
-std::vector<std::string> GEEvaluator::split(const std::string &str,
-                                            const std::string &delim) {
-    std::vector<std::string> chunks;
-    size_t prev = 0, pos = 0;
-    do {
-        pos = str.find(delim, prev);
-        if (pos == std::string::npos)
-            pos = str.length();
-        std::string token = str.substr(prev, pos - prev);
-        if (!token.empty())
-            chunks.push_back(token);
-        prev = pos + delim.length();
-    } while (pos < str.length() && prev < str.length());
+template <unsigned Bits>
+Fitness GEEvaluator<Bits>::evaluateStage(const Phenotype &phenotype,
+                                         size_t stage) noexcept {
+    try {
+        table.setFunc(phenotype);
+        return sampleFitness(*samples.at(stage)) / sample_baselines[stage];
+    } catch (hashInsertError &e) {
+        std::cerr << "Duplicity in training data: " << e.what() << std::endl;
+        return numeric_limits<Fitness>::max();
+    } catch (std::exception &e) {
+        std::cerr << e.what() << ": " << phenotype << std::endl;
+        return numeric_limits<Fitness>::max();
+    }
+}
 
-    return chunks;
+template <unsigned Bits> Fitness GEEvaluator<Bits>::randomFitness(void) const {
+    if (!reducers.empty()) {
+        /* combined fitness is sum of ratios to random function */
+        return static_cast<Fitness>(reducers.size());
+    }
+    return std::max(expectedFitness(table.getSize(), data->size()), 1.0);
 }
 
-void GEEvaluator::fitnessWithSum(
-    const std::array<uint16_t, numeric_limits<uint16_t>::max()> &arr,
-    Fitness &fit) {
+template <unsigned Bits>
+void GEEvaluator<Bits>::fitnessWithSum(const Dimensions &arr, Fitness &fit) {
 
-    /* temporary fitness sum */
-    Fitness temp = 0.0;
+    /* temporary fitness sum, exact as sum of squares of counts cannot
+     * exceed square of number of keys */
+    uint64_t temp = 0;
 
     /* calculate fitness as sum of current + previous values, greater than 1,
      * squared */
-    for (auto &a : arr) {
-        if (a > 1) {
-            temp += std::pow(a, 2);
-            fit += temp;
+    for (const uint64_t a : arr) {
+        const uint64_t square = a > 1 ? a * a : 0;
+        temp += square;
+        if (square != 0) {
+            fit += static_cast<Fitness>(temp);
         }
     }
 }
 
-void GEEvaluator::fitnessWithoutSum(
-    const std::array<uint16_t, numeric_limits<uint16_t>::max()> &arr,
-    Fitness &fit) {
+template <unsigned Bits>
+void GEEvaluator<Bits>::fitnessWithoutSum(const Dimensions &arr,
+                                          Fitness &fit) {
 
     /* calculate fitness as sum of values, greater than 1, squared */
-    for (auto &a : arr) {
-        if (a > 1) {
-            fit += pow(a, 2);
-        }
+    uint64_t squares = 0;
+    for (const uint64_t a : arr) {
+        squares += a > 1 ? a * a : 0;
     }
-}
\ No newline at end of file
+    fit += static_cast<Fitness>(squares);
+}
+
+template class GEEvaluator<12>;
+template class GEEvaluator<16>;
+template class GEEvaluator<20>;
+template class GEEvaluator<24>;
@@ -10,6 +10,8 @@
  */
 
 #include "GEEvolution.h"
+#include <algorithm>
+#include <numeric>
 
 GEEvolution::GEEvolution(unique_ptr<gram::EvaluationDriver> evaluationDriver,
                          unique_ptr<gram::Logger> logger)
@@ -39,17 +41,188 @@ gram::Population
 GEEvolution::run(gram::Population population, unsigned long gen,
                  function<bool(gram::Population &, unsigned long)>
                      terminatingCondition) const {
+    GEPerfCounts total;
+    GEPerfCounts mark = count();
     evaluationDriver->evaluate(population.allIndividuals());
+    recordCounts(mark, mark, total);
 
     while (!terminatingCondition(population, gen)) {
+        const bool timed = stats && stats->timed;
+        const auto start = timed ? Clock::now() : Clock::time_point();
         logger->logProgress(population);
 
+        const auto logged = timed ? Clock::now() : start;
+        mark = count();
         population.reproduce();
 
+        const auto reproduced = timed ? Clock::now() : start;
+        const GEPerfCounts bred = count();
         evaluationDriver->evaluate(population.allIndividuals());
+        if (timed) {
+            recordTime(start, logged, reproduced);
+        }
+        recordCounts(mark, bred, total);
     }
 
     logger->logResult(population);
 
     return population;
-}
\ No newline at end of file
+}
+
+void GEEvolution::recordTime(Clock::time_point start,
+                             Clock::time_point logged,
+                             Clock::time_point reproduced) const {
+    using seconds = std::chrono::duration<double>;
+    stats->time.log = seconds(logged - start).count();
+    stats->time.reproduce = seconds(reproduced - logged).count();
+    stats->time.total = seconds(Clock::now() - start).count();
+}
+
+GEPerfCounts GEEvolution::count(void) const {
+    return stats && counters ? counters->read() : GEPerfCounts();
+}
+
+void GEEvolution::recordCounts(const GEPerfCounts &start,
+                               const GEPerfCounts &reproduced,
+                               GEPerfCounts &total) const {
+    if (!stats || !counters) {
+        return;
+    }
+    stats->reproduce_counts = reproduced - start;
+    stats->evaluate_counts = count() - reproduced;
+    total += stats->reproduce_counts;
+    total += stats->evaluate_counts;
+    stats->total_counts = total;
+}
+
+void GEEvolution::evaluate(std::vector<gram::Population> &islands) const {
+    gram::Individuals all;
+    for (auto &island : islands) {
+        auto &individuals = island.allIndividuals();
+        all.insert(all.end(), individuals.begin(), individuals.end());
+    }
+
+    evaluationDriver->evaluate(all);
+
+    size_t i = 0;
+    for (auto &island : islands) {
+        for (auto &individual : island.allIndividuals()) {
+            individual.setFitness(all[i++].fitness());
+        }
+    }
+}
+
+bool GEEvolution::isFirstBetter(const gram::Individual &a,
+                                const gram::Individual &b) const {
+    if (comparer) {
+        return comparer->isFirstBetter(a, b);
+    }
+    return a.fitness() < b.fitness();
+}
+
+void GEEvolution::migrate(std::vector<gram::Population> &islands,
+                          const GEMigration &migration) const {
+    const size_t n = islands.size();
+
+    /* best individuals of each island, taken before any island changes */
+    std::vector<gram::Individuals> best(n);
+    for (size_t i = 0; i < n; i++) {
+        const auto &individuals = islands[i].allIndividuals();
+        std::vector<size_t> order(individuals.size());
+        std::iota(order.begin(), order.end(), 0);
+        const size_t m = std::min<size_t>(migration.migrants, order.size());
+        const auto middle = order.begin() + static_cast<std::ptrdiff_t>(m);
+        std::partial_sort(order.begin(), middle, order.end(),
+                          [&](size_t a, size_t b) {
+                              return isFirstBetter(individuals[a],
+                                                   individuals[b]);
+                          });
+        for (size_t k = 0; k < m; k++) {
+            best[i].push_back(individuals[order[k]]);
+        }
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        /* migrants arriving to island i */
+        gram::Individuals incoming;
+        if (migration.topology == GEMigration::Topology::Ring) {
+            incoming = best[(i + n - 1) % n];
+        } else {
+            for (size_t j = 0; j < n; j++) {
+                if (j != i) {
+                    incoming.insert(incoming.end(), best[j].begin(),
+                                    best[j].end());
+                }
+            }
+        }
+
+        /* replace worst individuals, at most half of island */
+        auto &individuals = islands[i].allIndividuals();
+        std::vector<size_t> order(individuals.size());
+        std::iota(order.begin(), order.end(), 0);
+        const size_t m = std::min(incoming.size(), order.size() / 2);
+        const auto middle = order.begin() + static_cast<std::ptrdiff_t>(m);
+        std::partial_sort(order.begin(), middle, order.end(),
+                          [&](size_t a, size_t b) {
+                              return isFirstBetter(individuals[b],
+                                                   individuals[a]);
+                          });
+        for (size_t k = 0; k < m; k++) {
+            individuals[order[k]] = incoming[k];
+        }
+    }
+}
+
+gram::Population
+GEEvolution::run(std::vector<gram::Population> islands, unsigned long gen,
+                 const GEMigration &migration,
+                 function<bool(gram::Population &, unsigned long)>
+                     terminatingCondition) const {
+    /* island with best individual is the one logged */
+    auto best = [&islands](void) -> gram::Population & {
+        return *std::min_element(
+            islands.begin(), islands.end(),
+            [](gram::Population &a, gram::Population &b) {
+                return a.lowestFitness() < b.lowestFitness();
+            });
+    };
+
+    GEPerfCounts total;
+    GEPerfCounts mark = count();
+    evaluate(islands);
+    recordCounts(mark, mark, total);
+    unsigned long generation = 0;
+
+    while (std::none_of(islands.begin(), islands.end(),
+                        [&](gram::Population &island) {
+                            return terminatingCondition(island, gen);
+                        })) {
+        const bool timed = stats && stats->timed;
+        const auto start = timed ? Clock::now() : Clock::time_point();
+        logger->logProgress(best());
+
+        const auto logged = timed ? Clock::now() : start;
+        mark = count();
+        generation++;
+        if (islands.size() > 1 && generation % migration.interval == 0) {
+            migrate(islands, migration);
+        }
+
+        for (auto &island : islands) {
+            island.reproduce();
+        }
+
+        const auto reproduced = timed ? Clock::now() : start;
+        const GEPerfCounts bred = count();
+        evaluate(islands);
+        if (timed) {
+            recordTime(start, logged, reproduced);
+        }
+        recordCounts(mark, bred, total);
+    }
+
+    gram::Population &result = best();
+    logger->logResult(result);
+
+    return std::move(result);
+}
@@ -0,0 +1,41 @@
+/**
+ * @file GEFitnessDetails.cpp
+ * @author Adam Freiberg (xfreib00@stud.fit.vutbr.cz)
+ * @brief Source file for GEFitnessDetails class methods
+ * @version 0.1
+ * @date 2021-07-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include "GEFitnessDetails.h"
+#include "HashExpr.h"
+
+GEFitnessDetails::GEFitnessDetails(std::vector<std::string> names)
+    : part_names(std::move(names)) {
+    //
+}
+
+void GEFitnessDetails::store(const std::string &phenotype,
+                             std::vector<gram::Fitness> values) {
+    std::string k = key(phenotype);
+    std::lock_guard<std::mutex> lock(mtx);
+    this->values[std::move(k)] = std::move(values);
+}
+
+std::string GEFitnessDetails::key(const std::string &phenotype) const {
+    return canonical ? canonicalKey(phenotype, magic) : phenotype;
+}
+
+bool GEFitnessDetails::find(const std::string &phenotype,
+                            std::vector<gram::Fitness> &values) const {
+    const std::string k = key(phenotype);
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = this->values.find(k);
+    if (it == this->values.end()) {
+        return false;
+    }
+    values = it->second;
+    return true;
+}
@@ -10,6 +10,8 @@
  */
 
 #include "GEHash.h"
+#include <algorithm>
+#include <sstream>
 
 GEHash::GEHash(unsigned long generation, unsigned long population) {
     if (generation < 2) {
@@ -22,11 +24,13 @@ GEHash::GEHash(unsigned long generation, unsigned long population) {
     g = generation;
 }
 
-void GEHash::SetLogger(const std::string &outpath, bool debug) {
+void GEHash::SetLogger(const std::string &outpath, bool debug,
+                       bool stream) {
     log = std::make_unique<GELogger>(outpath, move(cfmLogger));
     if (debug) {
         log->setDebug(debug);
     }
+    log->setStreaming(stream);
 }
 
 void GEHash::SetGrammar(std::string &grammar, unsigned long limit) {
@@ -34,6 +38,8 @@ void GEHash::SetGrammar(std::string &grammar, unsigned long limit) {
         throw geGrammarError();
     }
 
+    grammar_src = grammar;
+    wrap_limit = limit;
     gramm = std::make_unique<ContextFreeGrammar>(parser.parse(grammar));
     auto gramLogger =
         std::make_unique<ContextFreeGrammar>(parser.parse(grammar));
@@ -42,11 +48,329 @@ void GEHash::SetGrammar(std::string &grammar, unsigned long limit) {
         std::make_unique<ContextFreeMapper>(std::move(gramLogger), limit);
 }
 
+/* create evaluator for table with 2^Bits indexes */
+template <unsigned Bits>
+static std::unique_ptr<GEEvaluatorBase>
+makeEvaluator(unsigned long magic, const std::shared_ptr<const GEDataset> &data,
+              bool useSum, HashEngine engine, unsigned long shards,
+              const std::vector<HashReducer> &reducers,
+              const std::shared_ptr<GEFitnessDetails> &details,
+              const std::vector<std::shared_ptr<const GEDataset>> &samples,
+              const std::optional<GEQuality> &quality,
+              const std::shared_ptr<GEFitnessDetails> &quality_details) {
+    auto eval =
+        std::make_unique<GEEvaluator<Bits>>(magic, data, useSum, engine);
+    eval->setShards(shards);
+    eval->setResolutions(reducers, details);
+    eval->setStages(samples);
+    if (quality) {
+        eval->setQuality(*quality, quality_details);
+    }
+    return eval;
+}
+
+std::shared_ptr<const GEDataset>
+GEHash::LoadDataset(const std::string &data_path) {
+    auto data = std::make_shared<const GEDataset>(data_path);
+
+    /* report training data statistics */
+    std::cout << "Loaded " << data->size() << " keys ("
+              << static_cast<double>(data->bytes()) / (1024.0 * 1024.0)
+              << " MiB) from " << data->path() << " in "
+              << data->loadTime() * 1000.0 << " ms" << std::endl;
+    return data;
+}
+
 void GEHash::SetEvaluator(unsigned long magic, const std::string &data_path,
-                          const bool &useSum) {
-    eval = std::make_unique<GEEvaluator>(magic, data_path, useSum);
-    cache = std::make_unique<EvaluatorCache>(move(eval));
-    driver = std::make_unique<SingleThreadDriver>(move(cfm), move(cache), true);
+                          const bool &useSum, HashEngine engine,
+                          unsigned bits) {
+    if (std::find(GEEvaluatorBits.begin(), GEEvaluatorBits.end(), bits) ==
+        GEEvaluatorBits.end()) {
+        throw geBitsError();
+    }
+    SetEvaluator(magic, LoadDataset(data_path), useSum, engine, bits);
+}
+
+void GEHash::SetEvaluator(unsigned long magic,
+                          std::shared_ptr<const GEDataset> data,
+                          const bool &useSum, HashEngine engine,
+                          unsigned bits) {
+    if (std::find(GEEvaluatorBits.begin(), GEEvaluatorBits.end(), bits) ==
+        GEEvaluatorBits.end()) {
+        throw geBitsError();
+    }
+
+    this->magic = magic;
+    this->bits = bits;
+    data_path = data->path();
+
+    /* counters include only threads created from now on, i.e. evaluation
+     * threads, so logger thread must already be running */
+    if (counting) {
+        if (log) {
+            log->start();
+        }
+        counters = std::make_shared<GEPerfCounters>();
+        if (!counters->available()) {
+            std::cerr << "Hardware performance counters are not available, "
+                         "counting disabled."
+                      << std::endl;
+            counters.reset();
+        }
+    }
+
+    /* per-table fitness of multi-resolution evaluation is logged */
+    if (details) {
+        details->setCanonical(magic);
+    }
+    if (log && details) {
+        log->setDetails(details);
+    }
+
+    /* quality metrics of evaluated phenotypes are logged */
+    std::shared_ptr<GEFitnessDetails> quality_details;
+    if (quality) {
+        quality_details = std::make_shared<GEFitnessDetails>(
+            std::vector<std::string>{"avalanche", "chi2", "max_load"});
+        quality_details->setCanonical(magic);
+        if (log) {
+            log->setQuality(quality_details);
+        }
+    }
+
+    /* samples of staged evaluation are shared by all evaluators */
+    std::vector<std::shared_ptr<const GEDataset>> samples;
+    for (const auto &s : stages) {
+        samples.push_back(std::make_shared<const GEDataset>(*data, s.fraction));
+    }
+
+    /* each thread needs its own evaluator */
+    std::vector<std::unique_ptr<GEEvaluatorBase>> evals;
+    for (unsigned long i = 0; i < threads; i++) {
+        switch (bits) {
+        case 12:
+            evals.push_back(
+                makeEvaluator<12>(magic, data, useSum, engine, shards,
+                                  reducers, details, samples, quality,
+                                  quality_details));
+            break;
+        case 16:
+            evals.push_back(
+                makeEvaluator<16>(magic, data, useSum, engine, shards,
+                                  reducers, details, samples, quality,
+                                  quality_details));
+            break;
+        case 20:
+            evals.push_back(
+                makeEvaluator<20>(magic, data, useSum, engine, shards,
+                                  reducers, details, samples, quality,
+                                  quality_details));
+            break;
+        default:
+            evals.push_back(
+                makeEvaluator<24>(magic, data, useSum, engine, shards,
+                                  reducers, details, samples, quality,
+                                  quality_details));
+            break;
+        }
+    }
+    driver = std::make_unique<GEDriver>(move(cfm), move(evals));
+    driver->setStages(stages);
+    driver->setCanonical(magic);
+
+    /* everything fitness depends on besides phenotype */
+    if (!cache_path.empty()) {
+        std::stringstream config;
+        config << "gehash-cache 1 data=" << std::hex << data->fingerprint()
+               << std::dec << ":" << data->size() << " bits=" << bits
+               << " sum=" << useSum << " magic=" << magic << " res=";
+        for (const auto &r : reducers) {
+            config << r.name() << ",";
+        }
+        if (quality) {
+            config << " quality=" << quality->avalanche << ":" << quality->chi2
+                   << ":" << quality->max_load << ":" << quality->keys;
+        }
+        driver->setPersistentCache(
+            std::make_unique<GEPersistentCache>(cache_path, config.str()));
+    }
+
+    /* statistics of each generation are logged */
+    stats = std::make_shared<GEStats>();
+    driver->setStats(stats);
+    if (log) {
+        log->setStats(stats);
+    }
+}
+
+void GEHash::SetThreads(unsigned long threads, unsigned long shards) {
+    if (threads < 1 || shards < 1) {
+        throw geThreadsError();
+    }
+    this->threads = threads;
+    this->shards = shards;
+}
+
+void GEHash::SetResolutions(const std::string &spec) {
+    if (spec.empty()) {
+        reducers.clear();
+        details.reset();
+        return;
+    }
+    reducers = HashReducer::parseList(spec);
+
+    std::vector<std::string> names;
+    for (const auto &r : reducers) {
+        names.push_back(r.name());
+    }
+    details = std::make_shared<GEFitnessDetails>(std::move(names));
+}
+
+void GEHash::SetStages(const std::string &spec) {
+    stages.clear();
+    if (spec.empty()) {
+        return;
+    }
+
+    std::stringstream ss(spec);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        const auto colon = item.find(':');
+        if (colon == std::string::npos) {
+            throw geStagesError();
+        }
+        GEStage stage;
+        size_t end_f = 0, end_t = 0;
+        try {
+            stage.fraction = std::stod(item.substr(0, colon), &end_f);
+            stage.threshold = std::stod(item.substr(colon + 1), &end_t);
+        } catch (std::exception &e) {
+            throw geStagesError();
+        }
+        if (end_f != colon || end_t != item.size() - colon - 1 ||
+            !(stage.fraction > 0.0 && stage.fraction < 1.0) ||
+            !(stage.threshold > 0.0)) {
+            throw geStagesError();
+        }
+        stages.push_back(stage);
+    }
+    if (stages.empty()) {
+        throw geStagesError();
+    }
+}
+
+void GEHash::SetQuality(const std::string &spec) {
+    quality.reset();
+    if (spec.empty()) {
+        return;
+    }
+
+    GEQuality parsed;
+    if (spec == "log") {
+        quality = parsed;
+        return;
+    }
+
+    std::stringstream ss(spec);
+    std::string item;
+    std::vector<std::string> items;
+    while (std::getline(ss, item, ':')) {
+        items.push_back(item);
+    }
+    if (items.size() != 3 && items.size() != 4) {
+        throw geQualityError();
+    }
+    try {
+        double *weights[] = {&parsed.avalanche, &parsed.chi2,
+                             &parsed.max_load};
+        for (size_t i = 0; i < 3; i++) {
+            size_t end = 0;
+            *weights[i] = std::stod(items[i], &end);
+            if (end != items[i].size() || !(*weights[i] >= 0.0)) {
+                throw geQualityError();
+            }
+        }
+        if (items.size() == 4) {
+            size_t end = 0;
+            parsed.keys = std::stoul(items[3], &end);
+            if (end != items[3].size() || parsed.keys < 1) {
+                throw geQualityError();
+            }
+        }
+    } catch (std::exception &e) {
+        throw geQualityError();
+    }
+    quality = parsed;
+}
+
+void GEHash::SetSeed(uint64_t seed) { this->seed = seed; }
+
+void GEHash::SetIslands(unsigned long islands, const std::string &migration) {
+    if (islands < 1) {
+        throw geIslandsError();
+    }
+
+    GEMigration parsed;
+    std::stringstream ss(migration);
+    std::string topology, interval, migrants;
+    if (!std::getline(ss, topology, ':') || !std::getline(ss, interval, ':') ||
+        !std::getline(ss, migrants) || !ss.eof()) {
+        throw geIslandsError();
+    }
+    if (topology == "ring") {
+        parsed.topology = GEMigration::Topology::Ring;
+    } else if (topology == "full") {
+        parsed.topology = GEMigration::Topology::Full;
+    } else {
+        throw geIslandsError();
+    }
+    try {
+        size_t end_i = 0, end_m = 0;
+        parsed.interval = std::stoul(interval, &end_i);
+        parsed.migrants = std::stoul(migrants, &end_m);
+        if (end_i != interval.size() || end_m != migrants.size()) {
+            throw geIslandsError();
+        }
+    } catch (std::exception &e) {
+        throw geIslandsError();
+    }
+    if (parsed.interval < 1) {
+        throw geIslandsError();
+    }
+
+    this->islands = islands;
+    this->migration = parsed;
+}
+
+void GEHash::SetExport(const std::string &prefix) { export_prefix = prefix; }
+
+void GEHash::SetTiming(bool timing) { this->timing = timing; }
+
+void GEHash::SetCounters(bool counting) { this->counting = counting; }
+
+void GEHash::SetPareto(bool pareto) { this->pareto = pareto; }
+
+void GEHash::SetCache(const std::string &path) { cache_path = path; }
+
+void GEHash::SetCutoff(const std::string &cutoff) {
+    if (cutoff.empty() || cutoff == "none") {
+        cutoff_mode = CutoffMode::None;
+    } else if (cutoff == "worst") {
+        cutoff_mode = CutoffMode::Worst;
+    } else if (cutoff == "tournament") {
+        cutoff_mode = CutoffMode::Tournament;
+    } else {
+        size_t end = 0;
+        try {
+            cutoff_value = std::stod(cutoff, &end);
+        } catch (std::exception &e) {
+            throw geCutoffError();
+        }
+        if (end != cutoff.size() || !(cutoff_value >= 0.0)) {
+            throw geCutoffError();
+        }
+        cutoff_mode = CutoffMode::Value;
+    }
 }
 
 void GEHash::SetTournament(unsigned long size) {
@@ -64,39 +388,111 @@ void GEHash::SetProbability(double probability) {
 }
 
 void GEHash::Run(void) {
-    // selection
-    auto numGen1 = std::make_unique<StdNumberGenerator<std::mt19937>>();
-    auto comparer = std::make_unique<LowFitnessComparer>();
-    auto selector = std::make_unique<TournamentSelector>(t_size, move(numGen1),
-                                                         move(comparer));
-
-    // crossover
-    auto num2 = std::make_unique<StdNumberGenerator<std::mt19937>>();
-    auto crossover = std::make_unique<OnePointCrossover>(move(num2));
-
-    // mutation
-    Probability prob(m_prob);
-    auto numGen3 = std::make_unique<StdNumberGenerator<std::mt19937>>();
-    auto stepGen =
-        std::make_unique<BernoulliStepGenerator>(prob, move(numGen3));
-    auto numGen4 = std::make_unique<StdNumberGenerator<std::mt19937>>();
-    auto mutation =
-        std::make_unique<CodonMutation>(move(stepGen), move(numGen4));
-
-    // reproducer
-    auto repr = std::make_unique<PassionateReproducer>(
-        move(selector), move(crossover), move(mutation));
-
-    auto num5 = std::make_unique<StdNumberGenerator<std::mt19937>>();
-    unsigned long len = 100;
-    RandomInitializer in(move(num5), len);
-    Population initial = in.initialize(p, move(repr));
+    /* generator for k-th random number consumer of run, seed is mixed
+     * first so that runs with consecutive seeds share no streams */
+    auto generator = [this](uint64_t k) -> std::unique_ptr<NumberGenerator> {
+        if (seed) {
+            return std::make_unique<GENumberGenerator>(
+                splitmix64(splitmix64(*seed) + k));
+        }
+        return std::make_unique<StdNumberGenerator<std::mt19937>>();
+    };
+    if (log && seed) {
+        log->setSeed(*seed);
+    }
+
+    /* cost is second objective, all islands share one ranking */
+    std::shared_ptr<GEPareto> ranking;
+    if (pareto) {
+        ranking = std::make_shared<GEPareto>();
+        driver->setPareto(ranking);
+        if (log) {
+            log->setPareto(ranking);
+        }
+    }
+
+    /* island k uses generators 5k + 1 to 5k + 5 */
+    auto island = [&](uint64_t k) -> Population {
+        // selection
+        auto numGen1 = generator(5 * k + 1);
+        std::unique_ptr<IndividualComparer> comparer;
+        if (ranking) {
+            comparer = std::make_unique<GEParetoComparer>(ranking);
+        } else {
+            comparer = std::make_unique<LowFitnessComparer>();
+        }
+        auto selector = std::make_unique<TournamentSelector>(
+            t_size, move(numGen1), move(comparer));
+
+        // crossover
+        auto num2 = generator(5 * k + 2);
+        auto crossover = std::make_unique<OnePointCrossover>(move(num2));
+
+        // mutation
+        Probability prob(m_prob);
+        auto numGen3 = generator(5 * k + 3);
+        auto stepGen =
+            std::make_unique<BernoulliStepGenerator>(prob, move(numGen3));
+        auto numGen4 = generator(5 * k + 4);
+        auto mutation =
+            std::make_unique<CodonMutation>(move(stepGen), move(numGen4));
+
+        // reproducer
+        auto repr = std::make_unique<PassionateReproducer>(
+            move(selector), move(crossover), move(mutation));
+
+        auto num5 = generator(5 * k + 5);
+        unsigned long len = 100;
+        RandomInitializer in(move(num5), len);
+        return in.initialize(p, move(repr));
+    };
+
+    driver->setCutoff(cutoff_mode, cutoff_value, t_size);
+    driver->setTiming(timing);
     GEEvolution evol(move(driver), move(log));
+    if (timing || counters) {
+        evol.setStats(stats);
+    }
+    evol.setCounters(counters);
+    if (ranking) {
+        evol.setComparer(std::make_shared<GEParetoComparer>(ranking));
+    }
+
+    auto terminate = [](Population &current_population,
+                        unsigned long gen) -> bool {
+        return current_population.lowestFitness() == 0.0 ||
+               current_population.generationNumber() == gen;
+    };
 
+    std::vector<Population> populations;
+    for (unsigned long k = 0; k < islands; k++) {
+        populations.push_back(island(k));
+    }
     Population last_gen =
-        evol.run(move(initial), g,
-                 [](Population &current_population, unsigned long gen) -> bool {
-                     return current_population.lowestFitness() == 0.0 ||
-                            current_population.generationNumber() == gen;
-                 });
-}
\ No newline at end of file
+        islands == 1
+            ? evol.run(move(populations.front()), g, terminate)
+            : evol.run(move(populations), g, migration, terminate);
+
+    if (!export_prefix.empty()) {
+        Export(last_gen);
+    }
+}
+
+void GEHash::Export(Population &last_gen) {
+    ContextFreeMapper mapper(
+        std::make_unique<ContextFreeGrammar>(parser.parse(grammar_src)),
+        wrap_limit);
+    const Phenotype phenotype =
+        mapper.map(last_gen.individualWithLowestFitness().genotype());
+
+    /* index of evaluated table, or of each resolution */
+    std::vector<HashReducer> list = reducers;
+    if (list.empty()) {
+        list.emplace_back(HashReducer::Kind::Fold, bits);
+    }
+
+    HashExporter(phenotype, magic, list).write(export_prefix, data_path);
+    std::cout << "Exported best hash function to " << export_prefix
+              << ".hpp, " << export_prefix << ".h and " << export_prefix
+              << "_bench.cpp" << std::endl;
+}
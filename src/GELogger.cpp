@@ -10,6 +10,7 @@
  */
 
 #include "GELogger.h"
+#include <cmath>
 
 GELogger::GELogger(const string &path,
                    unique_ptr<ContextFreeMapper> logMapper) {
@@ -27,63 +28,271 @@ GELogger::GELogger(const string &path,
 }
 
 void GELogger::logProgress(const Population &population) {
-    /* temporary object used for storing data about current population */
-    json j;
+    enqueue(population, false);
+}
 
-    /* log best individual in current generation */
-    j["status"] = "progress";
-    j["gen"] = population.generationNumber();
-    j["fitness"] = population.individualWithLowestFitness().fitness();
+void GELogger::logResult(const Population &population) {
+    enqueue(population, true);
 
-    /* if debug option is on, map and store phenotype of individual with
-     * currently best fitness */
-    if (debug) {
-        try {
-            j["phenotype"]["code"] =
-                population.individualWithLowestFitness().serialize(*mapper);
-        } catch (std::exception &e) {
-            j["phenotype"]["code"] = e.what();
+    /* output must be complete when run ends */
+    stop();
+}
+
+void GELogger::enqueue(const Population &population, bool final) {
+    /* copy only what is needed, the rest is done on background thread */
+    Snapshot s;
+    s.final = final;
+    s.gen = population.generationNumber();
+    const Individual &best = population.individualWithLowestFitness();
+    s.fitness = best.fitness();
+
+    /* phenotype is needed in debug mode, in final result and to find partial
+     * fitness values */
+    if (final || debug || details || quality) {
+        s.genotype = best.genotype();
+    }
+    if (stats) {
+        s.stats = *stats;
+    }
+    if (final && pareto) {
+        s.front = pareto->front();
+    }
+
+    start();
+
+    /* background thread is behind, wait for free slot */
+    while (!queue.push(s)) {
+        this_thread::yield();
+    }
+}
+
+void GELogger::consume(void) {
+    for (;;) {
+        if (auto s = queue.pop()) {
+            process(*s);
+            continue;
+        }
+        if (stopping.load(memory_order_acquire)) {
+            /* snapshots pushed before stop request */
+            while (auto s = queue.pop()) {
+                process(*s);
+            }
+            return;
         }
+        this_thread::sleep_for(chrono::milliseconds(1));
     }
-    /* store temporary object into ouput JSON object */
-    j_out.push_back(j);
 }
 
-void GELogger::logResult(const Population &population) {
-    /* temporary object used for storing data about current population */
+void GELogger::start(void) {
+    if (!worker.joinable()) {
+        stopping = false;
+        worker = thread(&GELogger::consume, this);
+    }
+}
+
+void GELogger::stop(void) {
+    if (worker.joinable()) {
+        stopping.store(true, memory_order_release);
+        worker.join();
+    }
+}
+
+void GELogger::process(const Snapshot &s) {
+    /* temporary object used for storing data about logged generation */
     json j;
 
-    /* log best individual in final generation */
-    j["status"] = "result";
-    j["gen"] = population.generationNumber();
-    j["fitness"] = population.individualWithLowestFitness().fitness();
-    try {
-        j["phenotype"]["code"] =
-            population.individualWithLowestFitness().serialize(*mapper);
-    } catch (const std::exception &e) {
-        j["phenotype"]["code"] = e.what();
+    /* log best individual of generation */
+    j["status"] = s.final ? "result" : "progress";
+    j["gen"] = s.gen;
+    j["fitness"] = s.fitness;
+
+    /* map and store phenotype of individual with best fitness, phenotype
+     * is also needed to find its partial fitness values */
+    if (s.genotype) {
+        const bool log_code = s.final || debug;
+        try {
+            const string code = mapper->map(*s.genotype);
+            if (log_code) {
+                j["phenotype"]["code"] = code;
+            }
+            logDetails(j, code);
+        } catch (const std::exception &e) {
+            if (log_code) {
+                j["phenotype"]["code"] = e.what();
+            }
+        }
+    }
+
+    if (s.stats) {
+        logStats(j, *s.stats);
+        if (s.final && s.stats->total_counts.mask != 0) {
+            j["stats"]["counters"]["total"] =
+                logCounts(s.stats->total_counts);
+        }
+    }
+    if (s.final && seed) {
+        j["seed"] = *seed;
+    }
+    for (const auto &m : s.front) {
+        json member = {{"fitness", m.objectives.fitness},
+                       {"cost", m.objectives.cost}};
+        try {
+            member["phenotype"]["code"] = mapper->map(m.genotype);
+        } catch (const std::exception &e) {
+            member["phenotype"]["code"] = e.what();
+        }
+        j["front"].push_back(member);
     }
 
-    /* store temporary object into ouput JSON object */
-    j_out.push_back(j);
+    write(j, s.final);
+}
+
+void GELogger::write(const json &j, bool final) {
+    if (!streaming) {
+        /* store temporary object into ouput JSON object */
+        j_out.push_back(j);
+        if (!final) {
+            return;
+        }
+        try {
+            out.open(outpath, ios::out);
+            if (!out) {
+                throw loggerOpenError();
+            }
+            /* write logger output to JSON file */
+            out << j_out.dump(4) << endl;
+        } catch (const std::exception &e) {
+            std::cerr << e.what() << '\n';
+        }
+        return;
+    }
 
     try {
-        out.open(outpath, ios::out);
-        if (!out) {
-            throw loggerOpenError();
+        /* open file on first generation, buffer must be set before */
+        if (!out.is_open()) {
+            buffer.resize(1 << 16);
+            out.rdbuf()->pubsetbuf(buffer.data(),
+                                   static_cast<streamsize>(buffer.size()));
+            out.open(outpath, ios::out | ios::trunc);
+            if (!out) {
+                throw loggerOpenError();
+            }
+            last_flush = chrono::steady_clock::now();
+        }
+        out << j.dump() << '\n';
+
+        const auto now = chrono::steady_clock::now();
+        if (final ||
+            chrono::duration<double>(now - last_flush).count() >=
+                flush_interval) {
+            out.flush();
+            last_flush = now;
         }
-        /* write logger output to JSON file */
-        out << j_out.dump(4) << endl;
     } catch (const std::exception &e) {
         std::cerr << e.what() << '\n';
     }
 }
 
+void GELogger::logDetails(json &j, const string &phenotype) const {
+    const pair<const char *, const GEFitnessDetails *> stores[] = {
+        {"resolutions", details.get()}, {"quality", quality.get()}};
+    for (const auto &[key, store] : stores) {
+        vector<Fitness> values;
+        if (!store || !store->find(phenotype, values)) {
+            continue;
+        }
+        const auto &names = store->names();
+        for (size_t i = 0; i < names.size() && i < values.size(); i++) {
+            j[key][names[i]] = values[i];
+        }
+    }
+}
+
+void GELogger::logStats(json &j, const GEStats &st) const {
+    j["stats"]["individuals"] = st.individuals;
+    j["stats"]["evaluated"] = st.evaluated;
+    j["stats"]["cache_hits"] = st.cache_hits;
+    j["stats"]["duplicates"] = st.duplicates;
+    j["stats"]["loaded"] = st.loaded;
+    /* share of individuals which were not evaluated */
+    if (st.individuals > 0) {
+        j["stats"]["hit_rate"] =
+            static_cast<double>(st.cache_hits + st.duplicates) /
+            static_cast<double>(st.individuals);
+    }
+    j["stats"]["truncated"] = st.truncated;
+    if (!std::isinf(st.cutoff)) {
+        j["stats"]["cutoff"] = st.cutoff;
+    }
+    for (const auto &s : st.stages) {
+        j["stats"]["stages"].push_back({{"fraction", s.fraction},
+                                        {"evaluated", s.evaluated},
+                                        {"promoted", s.promoted}});
+    }
+    if (st.evaluate_counts.mask != 0) {
+        j["stats"]["counters"]["evaluate"] = logCounts(st.evaluate_counts);
+        j["stats"]["counters"]["reproduce"] = logCounts(st.reproduce_counts);
+    }
+    if (!st.timed) {
+        return;
+    }
+    j["stats"]["time"] = {{"map", st.time.map},
+                          {"stages", st.time.stages},
+                          {"evaluate", st.time.evaluate},
+                          {"reproduce", st.time.reproduce},
+                          {"log", st.time.log},
+                          {"total", st.time.total}};
+    j["stats"]["keys_hashed"] = st.keys_hashed;
+    /* throughput of hash function evaluation */
+    const double hashing = st.time.stages + st.time.evaluate;
+    if (hashing > 0.0) {
+        j["stats"]["keys_per_s"] =
+            static_cast<double>(st.keys_hashed) / hashing;
+    }
+    j["stats"]["peak_rss_kb"] = st.peak_rss;
+}
+
+GELogger::json GELogger::logCounts(const GEPerfCounts &c) {
+    json j = json::object();
+    for (size_t e = 0; e < GEPerfCounts::Events; e++) {
+        const auto event = static_cast<GEPerfCounts::Event>(e);
+        if (c.has(event)) {
+            j[GEPerfCounts::name(event)] = c.value[e];
+        }
+    }
+    const auto cycles = c.value[GEPerfCounts::Cycles];
+    if (c.has(GEPerfCounts::Cycles) && c.has(GEPerfCounts::Instructions) &&
+        cycles > 0) {
+        j["ipc"] = static_cast<double>(c.value[GEPerfCounts::Instructions]) /
+                   static_cast<double>(cycles);
+    }
+    return j;
+}
+
+void GELogger::setStats(shared_ptr<GEStats> s) { stats = move(s); }
+
+void GELogger::setDetails(shared_ptr<GEFitnessDetails> d) {
+    details = move(d);
+}
+
+void GELogger::setQuality(shared_ptr<GEFitnessDetails> q) {
+    quality = move(q);
+}
+
+void GELogger::setStreaming(bool val) { streaming = val; }
+
+void GELogger::setSeed(uint64_t s) { seed = s; }
+
+void GELogger::setPareto(shared_ptr<const GEPareto> p) { pareto = move(p); }
+
 bool GELogger::getDebug(void) const { return debug; }
 
 void GELogger::setDebug(bool val) { debug = val; }
 
 GELogger::~GELogger() {
+    /* finish output of interrupted run */
+    stop();
+
     /* close file */
     out.close();
 }
\ No newline at end of file
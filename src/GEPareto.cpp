@@ -0,0 +1,150 @@
+/**
+ * @file GEPareto.cpp
+ * @author Adam Freiberg (xfreib00@stud.fit.vutbr.cz)
+ * @brief Source file for GEPareto class methods
+ * @version 0.1
+ * @date 2021-07-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include "GEPareto.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+size_t GEPareto::GenotypeHash::operator()(const gram::Genotype &g) const {
+    /* 64-bit FNV-1a over codons */
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (const auto codon : g) {
+        h ^= static_cast<uint64_t>(codon);
+        h *= 0x100000001b3ULL;
+    }
+    return static_cast<size_t>(h);
+}
+
+void GEPareto::rank(const gram::Individuals &individuals,
+                    const std::vector<double> &costs,
+                    const std::vector<char> &exact) {
+    const size_t n = individuals.size();
+    std::vector<GEObjectives> obj(n);
+    for (size_t i = 0; i < n; i++) {
+        obj[i] = {individuals[i].fitness(), costs[i]};
+    }
+
+    /* fast non-dominated sorting, count of individuals dominating each one
+     * and list of individuals it dominates */
+    std::vector<size_t> dominated_by(n, 0);
+    std::vector<std::vector<size_t>> dominates(n);
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = i + 1; j < n; j++) {
+            if (obj[i].dominates(obj[j])) {
+                dominates[i].push_back(j);
+                dominated_by[j]++;
+            } else if (obj[j].dominates(obj[i])) {
+                dominates[j].push_back(i);
+                dominated_by[i]++;
+            }
+        }
+    }
+
+    std::vector<std::vector<size_t>> fronts(1);
+    for (size_t i = 0; i < n; i++) {
+        if (dominated_by[i] == 0) {
+            fronts[0].push_back(i);
+        }
+    }
+    while (!fronts.back().empty()) {
+        std::vector<size_t> next;
+        for (size_t i : fronts.back()) {
+            for (size_t j : dominates[i]) {
+                if (--dominated_by[j] == 0) {
+                    next.push_back(j);
+                }
+            }
+        }
+        fronts.push_back(std::move(next));
+    }
+    fronts.pop_back();
+
+    /* crowding distance, boundary individuals of each objective are kept */
+    constexpr double inf = std::numeric_limits<double>::infinity();
+    std::vector<double> crowding(n, 0.0);
+    auto crowd = [&](std::vector<size_t> &front, auto objective) {
+        std::sort(front.begin(), front.end(), [&](size_t a, size_t b) {
+            return objective(obj[a]) < objective(obj[b]);
+        });
+        crowding[front.front()] = inf;
+        crowding[front.back()] = inf;
+        const double range =
+            objective(obj[front.back()]) - objective(obj[front.front()]);
+        if (!(range > 0.0) || std::isinf(range)) {
+            return;
+        }
+        for (size_t k = 1; k + 1 < front.size(); k++) {
+            crowding[front[k]] += (objective(obj[front[k + 1]]) -
+                                   objective(obj[front[k - 1]])) /
+                                  range;
+        }
+    };
+
+    ranks.clear();
+    for (size_t f = 0; f < fronts.size(); f++) {
+        crowd(fronts[f], [](const GEObjectives &o) { return o.fitness; });
+        crowd(fronts[f], [](const GEObjectives &o) { return o.cost; });
+        for (size_t i : fronts[f]) {
+            ranks.emplace(individuals[i].genotype(), Rank{f, crowding[i]});
+        }
+    }
+
+    /* estimated fitness is fine for selection, but not for result */
+    if (!fronts.empty()) {
+        for (size_t i : fronts[0]) {
+            if (exact[i]) {
+                archiveMember({individuals[i].genotype(), obj[i]});
+            }
+        }
+    }
+}
+
+void GEPareto::archiveMember(GEFrontMember member) {
+    const GEObjectives &o = member.objectives;
+    /* individuals which could not be evaluated are never part of front */
+    if (o.fitness == std::numeric_limits<gram::Fitness>::max() ||
+        !std::isfinite(o.cost)) {
+        return;
+    }
+    for (const auto &m : archive) {
+        const GEObjectives &a = m.objectives;
+        if (a.dominates(o) || (a.fitness == o.fitness && a.cost == o.cost)) {
+            return;
+        }
+    }
+
+    archive.erase(std::remove_if(archive.begin(), archive.end(),
+                                 [&](const GEFrontMember &m) {
+                                     return o.dominates(m.objectives);
+                                 }),
+                  archive.end());
+    const auto pos = std::upper_bound(
+        archive.begin(), archive.end(), o.fitness,
+        [](gram::Fitness f, const GEFrontMember &m) {
+            return f < m.objectives.fitness;
+        });
+    archive.insert(pos, std::move(member));
+}
+
+bool GEPareto::isFirstBetter(const gram::Individual &a,
+                             const gram::Individual &b) const {
+    const auto ra = ranks.find(a.genotype());
+    const auto rb = ranks.find(b.genotype());
+    if (ra == ranks.end() || rb == ranks.end()) {
+        return a.fitness() < b.fitness();
+    }
+    if (ra->second.front != rb->second.front) {
+        return ra->second.front < rb->second.front;
+    }
+    return ra->second.crowding > rb->second.crowding;
+}
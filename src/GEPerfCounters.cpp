@@ -0,0 +1,105 @@
+/**
+ * @file GEPerfCounters.cpp
+ * @author Adam Freiberg (xfreib00@stud.fit.vutbr.cz)
+ * @brief Source file for GEPerfCounters class methods
+ * @version 0.1
+ * @date 2021-07-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include "GEPerfCounters.h"
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+const char *GEPerfCounts::name(Event e) {
+    switch (e) {
+    case Cycles:
+        return "cycles";
+    case Instructions:
+        return "instructions";
+    case LLCMisses:
+        return "llc_misses";
+    default:
+        return "branch_misses";
+    }
+}
+
+GEPerfCounts &GEPerfCounts::operator+=(const GEPerfCounts &o) {
+    for (size_t e = 0; e < Events; e++) {
+        value[e] += o.value[e];
+    }
+    mask |= o.mask;
+    return *this;
+}
+
+GEPerfCounts GEPerfCounts::operator-(const GEPerfCounts &o) const {
+    GEPerfCounts d;
+    for (size_t e = 0; e < Events; e++) {
+        /* scaled values of multiplexed counters may decrease slightly */
+        d.value[e] = value[e] > o.value[e] ? value[e] - o.value[e] : 0;
+    }
+    d.mask = mask & o.mask;
+    return d;
+}
+
+GEPerfCounters::GEPerfCounters() {
+    /* generic events, LLC misses are reported as cache misses */
+    const uint64_t config[GEPerfCounts::Events] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+
+    for (size_t e = 0; e < GEPerfCounts::Events; e++) {
+        struct perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = config[e];
+        /* user space is allowed with perf_event_paranoid up to 2 */
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        /* threads created later by this one are counted too */
+        attr.inherit = 1;
+        attr.read_format =
+            PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        fds[e] = static_cast<int>(
+            syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        if (fds[e] >= 0) {
+            mask |= 1U << e;
+        }
+    }
+}
+
+GEPerfCounts GEPerfCounters::read(void) const {
+    GEPerfCounts counts;
+    for (size_t e = 0; e < GEPerfCounts::Events; e++) {
+        if (fds[e] < 0) {
+            continue;
+        }
+        /* value, time enabled and time running */
+        uint64_t buf[3];
+        if (::read(fds[e], buf, sizeof(buf)) != sizeof(buf) || buf[2] == 0) {
+            continue;
+        }
+        counts.value[e] =
+            buf[2] == buf[1]
+                ? buf[0]
+                : static_cast<uint64_t>(static_cast<double>(buf[0]) *
+                                        static_cast<double>(buf[1]) /
+                                        static_cast<double>(buf[2]));
+        counts.mask |= 1U << e;
+    }
+    return counts;
+}
+
+GEPerfCounters::~GEPerfCounters() {
+    for (int fd : fds) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
@@ -0,0 +1,190 @@
+/**
+ * @file GEPersistentCache.cpp
+ * @author Adam Freiberg (xfreib00@stud.fit.vutbr.cz)
+ * @brief Source file for GEPersistentCache class methods
+ * @version 0.1
+ * @date 2021-07-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include "GEPersistentCache.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <string>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* holds flock for its lifetime */
+class FileLock {
+  public:
+    FileLock(int fd, int operation) : fd(fd) {
+        while (flock(fd, operation) != 0) {
+            if (errno != EINTR) {
+                throw cacheIOError();
+            }
+        }
+    }
+    ~FileLock() { flock(fd, LOCK_UN); }
+
+  private:
+    int fd;
+};
+
+GEPersistentCache::GEPersistentCache(const std::string &path,
+                                     const std::string &config) {
+    /* 64-bit FNV-1a of configuration */
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (const char c : config) {
+        h = (h ^ static_cast<unsigned char>(c)) * 0x100000001b3ull;
+    }
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%016llx",
+                  static_cast<unsigned long long>(h));
+    id = buf;
+
+    fd = open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw cacheOpenError();
+    }
+}
+
+GEPersistentCache::~GEPersistentCache() {
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+size_t GEPersistentCache::load(Map &cache) {
+    std::string data;
+    {
+        FileLock lock(fd, LOCK_SH);
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            throw cacheIOError();
+        }
+        if (st.st_size <= offset) {
+            return 0;
+        }
+        data.resize(static_cast<size_t>(st.st_size - offset));
+        size_t done = 0;
+        while (done < data.size()) {
+            const ssize_t n = pread(fd, &data[done], data.size() - done,
+                                    offset + static_cast<off_t>(done));
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                throw cacheIOError();
+            }
+            done += static_cast<size_t>(n);
+        }
+    }
+
+    /* parse complete lines only, incomplete one is read again next time */
+    size_t inserted = 0;
+    size_t start = 0;
+    for (size_t eol = data.find('\n'); eol != std::string::npos;
+         eol = data.find('\n', start)) {
+        if (parseLine(data.substr(start, eol - start), cache)) {
+            inserted++;
+        }
+        start = eol + 1;
+    }
+    offset += static_cast<off_t>(start);
+    return inserted;
+}
+
+bool GEPersistentCache::parseLine(const std::string &line, Map &cache) const {
+    /* skip other configurations without parsing the rest */
+    if (line.compare(0, id.size(), id) != 0 || line.size() <= id.size() ||
+        line[id.size()] != '\t') {
+        return false;
+    }
+    const size_t tab = line.find('\t', id.size() + 1);
+    if (tab == std::string::npos) {
+        return false;
+    }
+
+    const size_t tab_len = line.find('\t', tab + 1);
+    if (tab_len == std::string::npos) {
+        return false;
+    }
+
+    const std::string value = line.substr(id.size() + 1, tab - id.size() - 1);
+    char *end = nullptr;
+    const gram::Fitness fitness = std::strtod(value.c_str(), &end);
+    if (value.empty() || *end != '\0') {
+        return false;
+    }
+
+    /* length of key detects line completed by other writer after crash */
+    const std::string length = line.substr(tab + 1, tab_len - tab - 1);
+    const unsigned long long len = std::strtoull(length.c_str(), &end, 10);
+    if (length.empty() || *end != '\0' || len != line.size() - tab_len - 1) {
+        return false;
+    }
+    return cache.emplace(line.substr(tab_len + 1), fitness).second;
+}
+
+void GEPersistentCache::append(
+    const std::vector<std::pair<std::string, gram::Fitness>> &entries) {
+    std::string data;
+    char value[64];
+    for (const auto &[key, fitness] : entries) {
+        if (key.find_first_of("\t\n") != std::string::npos) {
+            continue;
+        }
+        /* hexadecimal format is exact */
+        std::snprintf(value, sizeof(value), "%a", fitness);
+        data += id;
+        data += '\t';
+        data += value;
+        data += '\t';
+        data += std::to_string(key.size());
+        data += '\t';
+        data += key;
+        data += '\n';
+    }
+    if (data.empty()) {
+        return;
+    }
+
+    FileLock lock(fd, LOCK_EX);
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        throw cacheIOError();
+    }
+
+    /* terminate line left incomplete by interrupted process */
+    if (st.st_size > 0) {
+        char last = '\n';
+        if (pread(fd, &last, 1, st.st_size - 1) != 1) {
+            throw cacheIOError();
+        }
+        if (last != '\n') {
+            data.insert(data.begin(), '\n');
+        }
+    }
+
+    size_t done = 0;
+    while (done < data.size()) {
+        const ssize_t n = write(fd, data.data() + done, data.size() - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            throw cacheIOError();
+        }
+        done += static_cast<size_t>(n);
+    }
+
+    /* own entries are already cached, skip them if nothing else is unread */
+    if (offset == st.st_size) {
+        offset += static_cast<off_t>(data.size());
+    }
+}
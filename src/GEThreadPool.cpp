@@ -0,0 +1,101 @@
+/**
+ * @file GEThreadPool.cpp
+ * @author Adam Freiberg (xfreib00@stud.fit.vutbr.cz)
+ * @brief Source file for GEThreadPool class methods
+ * @version 0.1
+ * @date 2021-07-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include "GEThreadPool.h"
+#include <algorithm>
+
+GEThreadPool::GEThreadPool(size_t threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 1; i < threads; i++) {
+        workers.emplace_back(&GEThreadPool::loop, this, i);
+    }
+}
+
+void GEThreadPool::run(size_t tasks, const Task &fn) {
+    /* run small jobs inline */
+    if (workers.empty() || tasks <= 1) {
+        for (size_t i = 0; i < tasks; i++) {
+            fn(i, 0);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        job = &fn;
+        job_tasks = tasks;
+        next.store(0, std::memory_order_relaxed);
+        active = workers.size();
+        error = nullptr;
+        generation++;
+    }
+    start.notify_all();
+
+    /* calling thread is worker 0 */
+    work(0);
+
+    std::unique_lock<std::mutex> lock(mtx);
+    done.wait(lock, [this] { return active == 0; });
+    job = nullptr;
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void GEThreadPool::work(size_t id) {
+    for (size_t i = next.fetch_add(1, std::memory_order_relaxed); i < job_tasks;
+         i = next.fetch_add(1, std::memory_order_relaxed)) {
+        try {
+            (*job)(i, id);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    }
+}
+
+void GEThreadPool::loop(size_t id) {
+    size_t seen = 0;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            start.wait(lock, [&] { return stop || generation != seen; });
+            if (stop) {
+                return;
+            }
+            seen = generation;
+        }
+
+        work(id);
+
+        std::lock_guard<std::mutex> lock(mtx);
+        if (--active == 0) {
+            done.notify_one();
+        }
+    }
+}
+
+GEThreadPool::~GEThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stop = true;
+    }
+    start.notify_all();
+    for (auto &t : workers) {
+        t.join();
+    }
+}
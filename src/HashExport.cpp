@@ -0,0 +1,483 @@
+/**
+ * @file HashExport.cpp
+ * @author Adam Freiberg (xfreib00@stud.fit.vutbr.cz)
+ * @brief Source file for HashExporter class methods
+ * @version 0.1
+ * @date 2021-07-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include "HashExport.h"
+#include <cctype>
+#include <fstream>
+#include <sstream>
+
+/* helpers with defined result for all operands, x / 0 == 0 and x % 0 == 0
+ * here, while HashVM throws hashArithmeticError and phenotype fails, so
+ * evolved function never relied on this value; minimal value divided by -1
+ * wraps as in HashVM */
+static const char *helpers = R"(
+@SPEC@ uint64_t @NAME@_divu(uint64_t a, uint64_t b) @NOEXCEPT@{
+    return b ? a / b : 0;
+}
+
+@SPEC@ uint64_t @NAME@_modu(uint64_t a, uint64_t b) @NOEXCEPT@{
+    return b ? a % b : 0;
+}
+
+@SPEC@ uint64_t @NAME@_divs(uint64_t a, uint64_t b) @NOEXCEPT@{
+    if (b == 0) {
+        return 0;
+    }
+    if ((int64_t)b == -1) {
+        return 0 - a;
+    }
+    return (uint64_t)((int64_t)a / (int64_t)b);
+}
+
+@SPEC@ uint64_t @NAME@_mods(uint64_t a, uint64_t b) @NOEXCEPT@{
+    if (b == 0 || (int64_t)b == -1) {
+        return 0;
+    }
+    return (uint64_t)((int64_t)a % (int64_t)b);
+}
+)";
+
+static const char *bench_source = R"(
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#ifdef __SSE4_2__
+#include <nmmintrin.h>
+#endif
+
+using Key = std::array<uint32_t, 9>;
+
+/* load text (10 numbers per line) or binary ("GEHASHDS") training data */
+static std::vector<Key> load(const char *path) {
+    std::ifstream f(path, std::ios::binary);
+    const std::string s((std::istreambuf_iterator<char>(f)),
+                        std::istreambuf_iterator<char>());
+    std::vector<Key> keys;
+
+    uint32_t words = 0;
+    if (s.size() >= 32 && s.compare(0, 8, "GEHASHDS") == 0 &&
+        (std::memcpy(&words, s.data() + 12, sizeof(words)), words == 9)) {
+        uint64_t count = 0;
+        std::memcpy(&count, s.data() + 16, sizeof(count));
+        count = std::min<uint64_t>(count, (s.size() - 32) / sizeof(Key));
+        keys.resize(count);
+        std::memcpy(keys.data(), s.data() + 32, count * sizeof(Key));
+        return keys;
+    }
+
+    const char *p = s.c_str();
+    while (*p) {
+        uint64_t v[10];
+        int n = 0;
+        while (n < 10 && *p && *p != '\n') {
+            if (*p >= '0' && *p <= '9') {
+                char *end = nullptr;
+                v[n++] = std::strtoull(p, &end, 10);
+                p = end;
+            } else {
+                p++;
+            }
+        }
+        while (*p && *p != '\n') {
+            p++;
+        }
+        if (*p) {
+            p++;
+        }
+        if (n == 10) {
+            Key k;
+            for (int i = 0; i < 8; i++) {
+                k[i] = (uint32_t)v[i];
+            }
+            k[8] = (uint32_t)v[8] << 16 | (uint32_t)v[9];
+            keys.push_back(k);
+        }
+    }
+    return keys;
+}
+
+static uint64_t fnv1a(const Key &key) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (uint32_t w : key) {
+        for (int b = 0; b < 32; b += 8) {
+            h ^= (w >> b) & 0xff;
+            h *= 0x100000001b3ull;
+        }
+    }
+    return h;
+}
+
+static uint64_t crc32c(const Key &key) {
+#ifdef __SSE4_2__
+    uint32_t h = 0xffffffffu;
+    for (uint32_t w : key) {
+        h = _mm_crc32_u32(h, w);
+    }
+    return h ^ 0xffffffffu;
+#else
+    static const auto table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int j = 0; j < 8; j++) {
+                c = c & 1 ? (c >> 1) ^ 0x82f63b78u : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+    uint32_t h = 0xffffffffu;
+    for (uint32_t w : key) {
+        for (int b = 0; b < 32; b += 8) {
+            h = table[(h ^ (w >> b)) & 0xff] ^ (h >> 8);
+        }
+    }
+    return h ^ 0xffffffffu;
+#endif
+}
+
+static uint64_t mulxorshift(const Key &key) {
+    uint64_t h = 0;
+    for (uint32_t w : key) {
+        h = (h ^ w) * 0x9e3779b97f4a7c15ull;
+        h ^= h >> 32;
+    }
+    return h;
+}
+
+/* result of timed loop is stored, so it can not be optimized out */
+static volatile uint64_t sink;
+
+template <typename F>
+static void bench(const char *name, const std::vector<Key> &keys, F hash) {
+    using clock = std::chrono::steady_clock;
+
+    /* maximal load of table, not timed */
+    std::vector<uint32_t> table(@SIZE@);
+    for (const Key &k : keys) {
+        table[@INDEX@(hash(k))]++;
+    }
+    const uint32_t max_load = *std::max_element(table.begin(), table.end());
+
+    uint64_t sum = 0;
+    size_t rounds = 0;
+    double elapsed = 0.0;
+    const auto start = clock::now();
+    do {
+        for (const Key &k : keys) {
+            sum += @INDEX@(hash(k));
+        }
+        rounds++;
+        elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    } while (elapsed < 0.5);
+    sink = sum;
+
+    const double n = (double)keys.size() * (double)rounds;
+    std::printf("%-12s %8.2f ns/key %10.2f Mkeys/s  max load %u\n", name,
+                elapsed * 1e9 / n, n / elapsed / 1e6, max_load);
+}
+
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : "@DATA@";
+    const std::vector<Key> keys = load(path);
+    if (keys.empty()) {
+        std::fprintf(stderr, "No keys loaded from %s\n", path);
+        return EXIT_FAILURE;
+    }
+
+    std::printf("%zu keys from %s, table @REDUCER@\n", keys.size(), path);
+    bench("@NAME@", keys, [](const Key &k) { return @NAME@(k); });
+    bench("fnv1a", keys, fnv1a);
+    bench("crc32c", keys, crc32c);
+    bench("mulxorshift", keys, mulxorshift);
+    return EXIT_SUCCESS;
+}
+)";
+
+/* replace all occurrences of placeholder */
+static std::string substitute(std::string text, const std::string &from,
+                              const std::string &to) {
+    for (size_t pos = text.find(from); pos != std::string::npos;
+         pos = text.find(from, pos + to.size())) {
+        text.replace(pos, from.size(), to);
+    }
+    return text;
+}
+
+static std::string literal(uint64_t value) {
+    std::stringstream ss;
+    ss << "0x" << std::hex << value << "ull";
+    return ss.str();
+}
+
+/* canonical form of 32-bit result, see canonical() */
+static std::string normalize(HashType type, const std::string &e) {
+    if (type == HashType::Int32) {
+        return "(uint64_t)(int64_t)(int32_t)(" + e + ")";
+    }
+    if (type == HashType::UInt32) {
+        return "((" + e + ") & 0xffffffffull)";
+    }
+    return e;
+}
+
+/* conversion of operand to type of operation, same as HashVM::convert */
+static std::string convert(HashType from, HashType to, const std::string &e) {
+    if (from == HashType::Int32 && to == HashType::UInt32) {
+        return "((" + e + ") & 0xffffffffull)";
+    }
+    return e;
+}
+
+HashExporter::HashExporter(const std::string &phenotype, uint64_t magic,
+                           std::vector<HashReducer> reducers)
+    : phenotype(phenotype), magic(magic), reducers(std::move(reducers)) {
+    HashParser parser;
+    ast = parser.parse(phenotype);
+}
+
+std::string HashExporter::expression(const HashNode &n,
+                                     const std::string &name) const {
+    if (uint64_t value; constantValue(n, value)) {
+        return literal(value);
+    }
+
+    switch (n.op) {
+    case HashOp::Hash:
+        return "h";
+    case HashOp::Key:
+        return "k";
+    case HashOp::Magic:
+        return literal(magic);
+    case HashOp::Not:
+    case HashOp::Neg: {
+        const std::string e = (n.op == HashOp::Not ? "(~" : "(0 - ") +
+                              expression(*n.lhs, name) + ")";
+        return isNarrow(n.type) ? normalize(n.type, e) : e;
+    }
+    default:
+        break;
+    }
+
+    /* constant operands are converted to type of operation right away */
+    auto operand = [&](const HashNode &o) {
+        if (uint64_t value; constantValue(o, value)) {
+            return literal(canonical(n.type, value));
+        }
+        return convert(o.type, n.type, expression(o, name));
+    };
+    const std::string a = operand(*n.lhs);
+    const std::string b = operand(*n.rhs);
+    const uint64_t mask = isNarrow(n.type) ? 31 : 63;
+    uint64_t value = 0;
+    const std::string count =
+        constantValue(*n.rhs, value)
+            ? std::to_string(value & mask)
+            : "(" + b + " & " + std::to_string(mask) + ")";
+    const bool s = isSigned(n.type);
+
+    std::string e;
+    bool norm = isNarrow(n.type);
+    switch (n.op) {
+    case HashOp::Add:
+        e = "(" + a + " + " + b + ")";
+        break;
+    case HashOp::Sub:
+        e = "(" + a + " - " + b + ")";
+        break;
+    case HashOp::Mul:
+        e = "(" + a + " * " + b + ")";
+        break;
+    case HashOp::Div:
+        e = name + (s ? "_divs(" : "_divu(") + a + ", " + b + ")";
+        norm = norm && s;
+        break;
+    case HashOp::Mod:
+        e = name + (s ? "_mods(" : "_modu(") + a + ", " + b + ")";
+        norm = norm && s;
+        break;
+    case HashOp::And:
+        e = "(" + a + " & " + b + ")";
+        norm = false;
+        break;
+    case HashOp::Or:
+        e = "(" + a + " | " + b + ")";
+        norm = false;
+        break;
+    case HashOp::Xor:
+        e = "(" + a + " ^ " + b + ")";
+        norm = false;
+        break;
+    case HashOp::Shl:
+        e = "(" + a + " << " + count + ")";
+        break;
+    default:
+        e = s ? "(uint64_t)((int64_t)" + a + " >> " + count + ")"
+              : "(" + a + " >> " + count + ")";
+        norm = false;
+        break;
+    }
+    return norm ? normalize(n.type, e) : e;
+}
+
+std::string HashExporter::body(const std::string &name) const {
+    std::stringstream ss;
+    ss << "    uint64_t h = 0;\n"
+       << "    for (size_t i = 0; i < words; i++) {\n"
+       << "        const uint64_t k = key[i];\n"
+       << "        (void)k;\n";
+    for (const auto &stmt : ast) {
+        ss << "        h = " << expression(*stmt, name) << ";\n";
+    }
+    ss << "    }\n"
+       << "    return h;\n";
+    return ss.str();
+}
+
+/* comment with source of function shared by all generated files */
+static std::string banner(const std::string &phenotype, uint64_t magic) {
+    std::stringstream ss;
+    ss << "/* Generated by GEHash from hash function:\n *\n";
+    std::stringstream src(phenotype);
+    std::string line;
+    while (std::getline(src, line, ';')) {
+        const size_t first = line.find_first_not_of(" \t\r\n");
+        if (first != std::string::npos) {
+            ss << " *     " << line.substr(first) << ";\n";
+        }
+    }
+    ss << " *\n * with magic = " << literal(magic) << ".\n";
+    if (phenotype.find_first_of("/%") != std::string::npos) {
+        ss << " *\n * Division and modulo by zero yield 0 here. During "
+              "evolution they made\n * function fail, so its fitness never "
+              "depended on this value.\n";
+    }
+    ss << " */\n";
+    return ss.str();
+}
+
+std::string HashExporter::cppHeader(const std::string &name) const {
+    std::stringstream ss;
+    ss << banner(phenotype, magic) << "\n#pragma once\n\n"
+       << "#include <array>\n#include <cstddef>\n#include <cstdint>\n"
+       << substitute(
+              substitute(substitute(helpers, "@SPEC@", "constexpr"),
+                         "@NOEXCEPT@", "noexcept "),
+              "@NAME@", name)
+       << "\n/* hash of key, function is applied to each word in order */\n"
+       << "constexpr uint64_t " << name
+       << "(const uint32_t *key, size_t words) noexcept {\n"
+       << body(name) << "}\n\n"
+       << "constexpr uint64_t " << name
+       << "(const std::array<uint32_t, 9> &key) noexcept {\n"
+       << "    return " << name << "(key.data(), key.size());\n}\n";
+    for (const auto &r : reducers) {
+        ss << "\n/* index of table with " << r.size() << " slots */\n"
+           << "constexpr uint32_t " << name << "_" << r.name()
+           << "(uint64_t hash) noexcept {\n"
+           << "    return (uint32_t)(" << r.expression("hash") << ");\n}\n";
+    }
+    return ss.str();
+}
+
+std::string HashExporter::cHeader(const std::string &name) const {
+    std::string guard;
+    for (char c : name) {
+        guard += static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    }
+    guard += "_H";
+
+    std::stringstream ss;
+    ss << banner(phenotype, magic) << "\n#ifndef " << guard << "\n#define "
+       << guard << "\n\n#include <stddef.h>\n#include <stdint.h>\n"
+       << substitute(
+              substitute(substitute(helpers, "@SPEC@", "static inline"),
+                         "@NOEXCEPT@", ""),
+              "@NAME@", name)
+       << "\n/* hash of key, function is applied to each word in order */\n"
+       << "static inline uint64_t " << name
+       << "(const uint32_t *key, size_t words) {\n"
+       << body(name) << "}\n";
+    for (const auto &r : reducers) {
+        ss << "\n/* index of table with " << r.size() << " slots */\n"
+           << "static inline uint32_t " << name << "_" << r.name()
+           << "(uint64_t hash) {\n"
+           << "    return (uint32_t)(" << r.expression("hash") << ");\n}\n";
+    }
+    ss << "\n#endif /* " << guard << " */\n";
+    return ss.str();
+}
+
+std::string HashExporter::benchmark(const std::string &name,
+                                    const std::string &header,
+                                    const std::string &data_path) const {
+    /* escape path for string literal */
+    std::string data;
+    for (char c : data_path) {
+        if (c == '\\' || c == '"') {
+            data += '\\';
+        }
+        data += c;
+    }
+
+    const HashReducer &r = reducers.front();
+    std::stringstream ss;
+    ss << banner(phenotype, magic)
+       << "\n/* Benchmark of " << name << " against common hash functions.\n"
+       << " * Build: c++ -std=c++17 -O3 -march=native " << name
+       << "_bench.cpp -o " << name << "_bench\n"
+       << " * Usage: ./" << name << "_bench [TRAINING_DATA]\n */\n\n"
+       << "#include \"" << header << "\"\n";
+
+    std::string src = bench_source;
+    src = substitute(src, "@INDEX@", name + "_" + r.name());
+    src = substitute(src, "@SIZE@", std::to_string(r.size()));
+    src = substitute(src, "@REDUCER@", r.name());
+    src = substitute(src, "@DATA@", data);
+    src = substitute(src, "@NAME@", name);
+    ss << src;
+    return ss.str();
+}
+
+void HashExporter::write(const std::string &prefix,
+                         const std::string &data_path) const {
+    /* name of function is file name of prefix turned into identifier */
+    const size_t slash = prefix.find_last_of('/');
+    const std::string base =
+        slash == std::string::npos ? prefix : prefix.substr(slash + 1);
+    std::string name;
+    for (char c : base) {
+        name += std::isalnum(static_cast<unsigned char>(c)) ? c : '_';
+    }
+    if (name.empty() || std::isdigit(static_cast<unsigned char>(name[0]))) {
+        name = "gehash_" + name;
+    }
+
+    auto save = [](const std::string &path, const std::string &content) {
+        std::ofstream f(path, std::ios::out | std::ios::trunc);
+        f << content;
+        f.close();
+        if (!f) {
+            throw hashExportError();
+        }
+    };
+    save(prefix + ".hpp", cppHeader(name));
+    save(prefix + ".h", cHeader(name));
+    save(prefix + "_bench.cpp", benchmark(name, base + ".hpp", data_path));
+}
@@ -0,0 +1,645 @@
+/**
+ * @file HashExpr.cpp
+ * @author Adam Freiberg (xfreib00@stud.fit.vutbr.cz)
+ * @brief Source file for HashParser class methods and expression helpers
+ * @version 0.1
+ * @date 2021-07-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include "HashExpr.h"
+#include <algorithm>
+#include <cctype>
+#include <limits>
+
+/* maximal nesting of parsed expression, protects parser stack */
+static constexpr int max_nesting = 1024;
+
+/* precedence levels of binary operators, lowest first */
+static int precedence(const std::string &op) {
+    if (op == "|") {
+        return 0;
+    } else if (op == "^") {
+        return 1;
+    } else if (op == "&") {
+        return 2;
+    } else if (op == "<<" || op == ">>") {
+        return 3;
+    } else if (op == "+" || op == "-") {
+        return 4;
+    } else if (op == "*" || op == "/" || op == "%") {
+        return 5;
+    }
+    return -1;
+}
+
+static HashOp binaryOp(const std::string &op) {
+    switch (op[0]) {
+    case '|':
+        return HashOp::Or;
+    case '^':
+        return HashOp::Xor;
+    case '&':
+        return HashOp::And;
+    case '<':
+        return HashOp::Shl;
+    case '>':
+        return HashOp::Shr;
+    case '+':
+        return HashOp::Add;
+    case '-':
+        return HashOp::Sub;
+    case '*':
+        return HashOp::Mul;
+    case '/':
+        return HashOp::Div;
+    default:
+        return HashOp::Mod;
+    }
+}
+
+std::unique_ptr<HashNode> makeBinary(HashOp op, std::unique_ptr<HashNode> lhs,
+                                     std::unique_ptr<HashNode> rhs) {
+    auto n = std::make_unique<HashNode>();
+    n->op = op;
+    n->type = commonType(lhs->type, rhs->type);
+    n->lhs = std::move(lhs);
+    n->rhs = std::move(rhs);
+    return n;
+}
+
+std::unique_ptr<HashNode> makeUnary(HashOp op,
+                                    std::unique_ptr<HashNode> operand) {
+    auto n = std::make_unique<HashNode>();
+    n->op = op;
+    n->type = operand->type;
+    n->lhs = std::move(operand);
+    return n;
+}
+
+std::unique_ptr<HashNode> makeConst(HashType type, uint64_t value) {
+    auto n = std::make_unique<HashNode>();
+    n->op = HashOp::Const;
+    n->type = type;
+    n->value = canonical(type, value);
+    return n;
+}
+
+uint64_t applyOp(HashOp op, HashType type, uint64_t a, uint64_t b) {
+    /* operands are converted to common type first */
+    a = canonical(type, a);
+    b = canonical(type, b);
+    const uint64_t mask = isNarrow(type) ? 31 : 63;
+
+    switch (op) {
+    case HashOp::Not:
+        return canonical(type, ~a);
+    case HashOp::Neg:
+        return canonical(type, 0 - a);
+    case HashOp::Add:
+        return canonical(type, a + b);
+    case HashOp::Sub:
+        return canonical(type, a - b);
+    case HashOp::Mul:
+        return canonical(type, a * b);
+    case HashOp::Div:
+    case HashOp::Mod:
+        if (b == 0) {
+            throw hashArithmeticError();
+        }
+        if (isSigned(type)) {
+            auto sa = static_cast<int64_t>(a);
+            auto sb = static_cast<int64_t>(b);
+            /* avoid trap on minimal value divided by -1, result wraps */
+            if (sb == -1) {
+                return canonical(type, op == HashOp::Div ? 0 - a : 0);
+            }
+            return canonical(type, static_cast<uint64_t>(
+                                       op == HashOp::Div ? sa / sb : sa % sb));
+        }
+        return op == HashOp::Div ? a / b : a % b;
+    case HashOp::And:
+        return a & b;
+    case HashOp::Or:
+        return a | b;
+    case HashOp::Xor:
+        return a ^ b;
+    case HashOp::Shl:
+        return canonical(type, a << (b & mask));
+    case HashOp::Shr:
+        if (isSigned(type)) {
+            return static_cast<uint64_t>(static_cast<int64_t>(a) >>
+                                         (b & mask));
+        }
+        return a >> (b & mask);
+    default:
+        throw hashCompileError();
+    }
+}
+
+bool constantValue(const HashNode &n, uint64_t &value) {
+    switch (n.op) {
+    case HashOp::Const:
+        value = n.value;
+        return true;
+    case HashOp::Hash:
+    case HashOp::Key:
+    case HashOp::Magic:
+        return false;
+    default:
+        break;
+    }
+
+    uint64_t a = 0, b = 0;
+    if (!constantValue(*n.lhs, a) || (n.rhs && !constantValue(*n.rhs, b))) {
+        return false;
+    }
+
+    try {
+        value = applyOp(n.op, n.type, a, b);
+    } catch (hashArithmeticError &e) {
+        /* leave error to be reported at run time */
+        return false;
+    }
+    return true;
+}
+
+HashAst HashParser::parse(const std::string &src) {
+    HashAst ast;
+    text = src;
+    pos = 0;
+    depth = 0;
+
+    next();
+    while (tok != Token::End) {
+        /* skip empty statements */
+        if (tok == Token::Semicolon) {
+            next();
+            continue;
+        }
+        ast.push_back(statement());
+    }
+
+    if (ast.empty()) {
+        throw hashCompileError();
+    }
+
+    return ast;
+}
+
+void HashParser::next(void) {
+    while (pos < text.size() &&
+           std::isspace(static_cast<unsigned char>(text[pos]))) {
+        pos++;
+    }
+
+    if (pos >= text.size()) {
+        tok = Token::End;
+        tok_text.clear();
+        return;
+    }
+
+    const size_t start = pos;
+    const auto c = static_cast<unsigned char>(text[pos]);
+
+    if (std::isalpha(c) || c == '_') {
+        while (pos < text.size() &&
+               (std::isalnum(static_cast<unsigned char>(text[pos])) ||
+                text[pos] == '_')) {
+            pos++;
+        }
+        tok = Token::Ident;
+    } else if (std::isdigit(c)) {
+        while (pos < text.size() &&
+               std::isalnum(static_cast<unsigned char>(text[pos]))) {
+            pos++;
+        }
+        tok = Token::Number;
+    } else if (c == ';') {
+        pos++;
+        tok = Token::Semicolon;
+    } else {
+        /* longest match of operator, including compound assignments */
+        static const char *ops[] = {"<<=", ">>=", "<<", ">>", "+=", "-=",
+                                    "*=",  "/=",  "%=", "&=", "|=", "^="};
+        tok = Token::Op;
+        for (const char *op : ops) {
+            if (text.compare(pos, std::char_traits<char>::length(op), op) ==
+                0) {
+                pos += std::char_traits<char>::length(op);
+                tok_text = text.substr(start, pos - start);
+                return;
+            }
+        }
+        pos++;
+    }
+    tok_text = text.substr(start, pos - start);
+}
+
+std::unique_ptr<HashNode> HashParser::statement(void) {
+    /* statement must assign to hash variable */
+    if (tok != Token::Ident || tok_text != "hash") {
+        throw hashCompileError();
+    }
+    next();
+
+    if (tok != Token::Op || tok_text.back() != '=' || tok_text == "==") {
+        throw hashCompileError();
+    }
+    const std::string assign = tok_text;
+    next();
+
+    auto expr = binary(0);
+
+    /* expand compound assignment, hash is always the left operand */
+    if (assign.size() > 1) {
+        auto hash = std::make_unique<HashNode>();
+        hash->op = HashOp::Hash;
+        hash->type = HashType::UInt64;
+        expr = makeBinary(binaryOp(assign.substr(0, assign.size() - 1)),
+                          std::move(hash), std::move(expr));
+    }
+
+    if (tok == Token::Semicolon) {
+        next();
+    } else if (tok != Token::End) {
+        throw hashCompileError();
+    }
+
+    return expr;
+}
+
+std::unique_ptr<HashNode> HashParser::binary(int level) {
+    if (++depth > max_nesting) {
+        throw hashCompileError();
+    }
+
+    auto lhs = unary();
+
+    /* precedence climbing, all binary operators are left associative */
+    for (;;) {
+        int prec = tok == Token::Op ? precedence(tok_text) : -1;
+        if (prec < level) {
+            break;
+        }
+        HashOp op = binaryOp(tok_text);
+        next();
+        auto rhs = binary(prec + 1);
+        lhs = makeBinary(op, std::move(lhs), std::move(rhs));
+    }
+
+    depth--;
+    return lhs;
+}
+
+std::unique_ptr<HashNode> HashParser::unary(void) {
+    if (tok == Token::Op &&
+        (tok_text == "~" || tok_text == "-" || tok_text == "+")) {
+        const char op = tok_text[0];
+        if (++depth > max_nesting) {
+            throw hashCompileError();
+        }
+        next();
+        auto operand = unary();
+        depth--;
+        if (op == '+') {
+            return operand;
+        }
+        return makeUnary(op == '~' ? HashOp::Not : HashOp::Neg,
+                         std::move(operand));
+    }
+    return primary();
+}
+
+std::unique_ptr<HashNode> HashParser::primary(void) {
+    std::unique_ptr<HashNode> n;
+
+    if (tok == Token::Number) {
+        n = literal();
+    } else if (tok == Token::Ident) {
+        n = std::make_unique<HashNode>();
+        if (tok_text == "hash") {
+            n->op = HashOp::Hash;
+            n->type = HashType::UInt64;
+        } else if (tok_text == "key") {
+            n->op = HashOp::Key;
+            n->type = HashType::UInt32;
+        } else if (tok_text == "magic") {
+            n->op = HashOp::Magic;
+            n->type = HashType::UInt64;
+        } else {
+            throw hashCompileError();
+        }
+    } else if (tok == Token::Op && tok_text == "(") {
+        next();
+        n = binary(0);
+        if (tok != Token::Op || tok_text != ")") {
+            throw hashCompileError();
+        }
+    } else {
+        throw hashCompileError();
+    }
+
+    next();
+    return n;
+}
+
+std::unique_ptr<HashNode> HashParser::literal(void) {
+    /* split literal to digits and suffix */
+    int base = 10;
+    size_t start = 0;
+    if (tok_text.size() > 1 && tok_text[0] == '0') {
+        if (tok_text[1] == 'x' || tok_text[1] == 'X') {
+            base = 16;
+            start = 2;
+        } else if (tok_text[1] == 'b' || tok_text[1] == 'B') {
+            base = 2;
+            start = 2;
+        } else {
+            base = 8;
+            start = 1;
+        }
+    }
+
+    size_t end = start;
+    while (end < tok_text.size() &&
+           std::isxdigit(static_cast<unsigned char>(tok_text[end]))) {
+        if (base != 16 && !std::isdigit(static_cast<unsigned char>(
+                              tok_text[end]))) {
+            break;
+        }
+        end++;
+    }
+
+    bool is_unsigned = false;
+    bool is_long = false;
+    for (size_t i = end; i < tok_text.size(); i++) {
+        const char s = static_cast<char>(
+            std::tolower(static_cast<unsigned char>(tok_text[i])));
+        if (s == 'u' && !is_unsigned) {
+            is_unsigned = true;
+        } else if (s == 'l') {
+            is_long = true;
+        } else {
+            throw hashCompileError();
+        }
+    }
+
+    if (end == start && base != 8) {
+        throw hashCompileError();
+    }
+
+    /* accumulate value, rejecting digits out of base and overflow */
+    uint64_t value = 0;
+    for (size_t i = start; i < end; i++) {
+        const auto c = static_cast<unsigned char>(tok_text[i]);
+        const auto digit = static_cast<uint64_t>(
+            std::isdigit(c) ? c - '0' : std::tolower(c) - 'a' + 10);
+        if (digit >= static_cast<uint64_t>(base) ||
+            value > (std::numeric_limits<uint64_t>::max() - digit) /
+                        static_cast<uint64_t>(base)) {
+            throw hashCompileError();
+        }
+        value = value * static_cast<uint64_t>(base) + digit;
+    }
+
+    /* choose literal type using C rules, decimal literals are signed unless
+     * they fit only into unsigned long */
+    const bool any_sign = base != 10 || is_unsigned;
+    HashType type;
+    if (!is_long && !is_unsigned &&
+        value <= static_cast<uint64_t>(std::numeric_limits<int32_t>::max())) {
+        type = HashType::Int32;
+    } else if (!is_long && any_sign &&
+               value <= std::numeric_limits<uint32_t>::max()) {
+        type = HashType::UInt32;
+    } else if (!is_unsigned &&
+               value <= static_cast<uint64_t>(
+                            std::numeric_limits<int64_t>::max())) {
+        type = HashType::Int64;
+    } else {
+        type = HashType::UInt64;
+    }
+
+    return makeConst(type, value);
+}
+
+/* check if evaluation of node may fail */
+static bool mayFail(const HashNode &n) {
+    if (n.op == HashOp::Div || n.op == HashOp::Mod) {
+        return true;
+    }
+    return (n.lhs && mayFail(*n.lhs)) || (n.rhs && mayFail(*n.rhs));
+}
+
+/* check if node reads hash variable */
+static bool usesHash(const HashNode &n) {
+    if (n.op == HashOp::Hash) {
+        return true;
+    }
+    return (n.lhs && usesHash(*n.lhs)) || (n.rhs && usesHash(*n.rhs));
+}
+
+/* write node in prefix notation, each operation is annotated with its type
+ * as it changes semantics of operation */
+static void serialize(const HashNode &n, std::string &out) {
+    static const char *types[] = {"i32", "u32", "i64", "u64"};
+    static const char *ops[] = {"h",   "k",   "m",   "c",   "not", "neg",
+                                "add", "sub", "mul", "div", "mod", "and",
+                                "or",  "xor", "shl", "shr"};
+
+    out += ops[static_cast<size_t>(n.op)];
+    if (n.op == HashOp::Hash || n.op == HashOp::Key) {
+        return;
+    }
+    out += '.';
+    out += types[static_cast<size_t>(n.type)];
+    if (n.op == HashOp::Const) {
+        out += ':';
+        out += std::to_string(n.value);
+        return;
+    }
+    out += '(';
+    serialize(*n.lhs, out);
+    if (n.rhs) {
+        out += ',';
+        serialize(*n.rhs, out);
+    }
+    out += ')';
+}
+
+/* rewrite node to canonical form, returns its serialization */
+static std::string canonicalNode(std::unique_ptr<HashNode> &n,
+                                 uint64_t magic) {
+    if (n->op == HashOp::Magic) {
+        n = makeConst(HashType::UInt64, magic);
+    }
+
+    std::string lhs, rhs;
+    if (n->lhs) {
+        lhs = canonicalNode(n->lhs, magic);
+    }
+    if (n->rhs) {
+        rhs = canonicalNode(n->rhs, magic);
+    }
+
+    uint64_t value = 0;
+    if (n->op != HashOp::Const && constantValue(*n, value)) {
+        n = makeConst(n->type, value);
+    }
+
+    switch (n->op) {
+    case HashOp::Not:
+    case HashOp::Neg:
+        /* ~~x and --x, type of unary operation is type of operand */
+        if (n->lhs->op == n->op) {
+            std::unique_ptr<HashNode> inner = std::move(n->lhs->lhs);
+            n = std::move(inner);
+        }
+        break;
+    case HashOp::Xor:
+    case HashOp::Sub:
+        if (lhs == rhs && !mayFail(*n)) {
+            n = makeConst(n->type, 0);
+        } else if (n->op == HashOp::Xor && rhs < lhs) {
+            /* commutative */
+            std::swap(n->lhs, n->rhs);
+        }
+        break;
+    case HashOp::And:
+    case HashOp::Or:
+        if (lhs == rhs) {
+            std::unique_ptr<HashNode> operand = std::move(n->lhs);
+            n = std::move(operand);
+            break;
+        }
+        /* commutative */
+        if (rhs < lhs) {
+            std::swap(n->lhs, n->rhs);
+        }
+        break;
+    case HashOp::Add:
+    case HashOp::Mul:
+        if (rhs < lhs) {
+            std::swap(n->lhs, n->rhs);
+        }
+        break;
+    default:
+        break;
+    }
+
+    std::string out;
+    serialize(*n, out);
+    return out;
+}
+
+/* rewrite statements to canonical form and drop those without effect,
+ * serializations of kept statements are stored to statements */
+static HashAst canonicalAst(const std::string &src, uint64_t magic,
+                            std::vector<std::string> &statements) {
+    HashParser parser;
+    HashAst ast = parser.parse(src);
+
+    std::vector<std::string> all;
+    for (auto &n : ast) {
+        all.push_back(canonicalNode(n, magic));
+    }
+
+    /* statement not reading hash overwrites all previous ones, they are
+     * dropped unless they may fail */
+    size_t last_reset = 0;
+    for (size_t i = 0; i < ast.size(); i++) {
+        if (!usesHash(*ast[i])) {
+            last_reset = i;
+        }
+    }
+
+    HashAst kept;
+    for (size_t i = 0; i < all.size(); i++) {
+        if (i < last_reset && !mayFail(*ast[i])) {
+            continue;
+        }
+        /* hash = hash; has no effect */
+        if (all[i] == "h") {
+            continue;
+        }
+        kept.push_back(std::move(ast[i]));
+        statements.push_back(std::move(all[i]));
+    }
+    return kept;
+}
+
+std::string canonicalForm(const std::string &src, uint64_t magic) {
+    std::vector<std::string> statements;
+    canonicalAst(src, magic, statements);
+
+    std::string out;
+    for (const auto &s : statements) {
+        out += s;
+        out += ';';
+    }
+    if (out.empty()) {
+        out = "h;";
+    }
+    return out;
+}
+
+std::string canonicalKey(const std::string &src, uint64_t magic) {
+    try {
+        return canonicalForm(src, magic);
+    } catch (hashCompileError &e) {
+        return src;
+    }
+}
+
+/* latency of operation in cycles on common x86-64 and AArch64 cores */
+static double latency(HashOp op) {
+    switch (op) {
+    case HashOp::Hash:
+    case HashOp::Key:
+    case HashOp::Magic:
+    case HashOp::Const:
+        return 0.0;
+    case HashOp::Mul:
+        return 3.0;
+    case HashOp::Div:
+    case HashOp::Mod:
+        return 25.0;
+    default:
+        return 1.0;
+    }
+}
+
+/* cycle in which result of node is ready, operations are counted */
+static double readyAt(const HashNode &n, double hash_ready,
+                      size_t &operations) {
+    if (n.op == HashOp::Hash) {
+        return hash_ready;
+    }
+    double operands = 0.0;
+    if (n.lhs) {
+        operands = readyAt(*n.lhs, hash_ready, operations);
+    }
+    if (n.rhs) {
+        operands = std::max(operands, readyAt(*n.rhs, hash_ready, operations));
+    }
+    if (latency(n.op) > 0.0) {
+        operations++;
+    }
+    return operands + latency(n.op);
+}
+
+HashCost hashCost(const std::string &src, uint64_t magic) {
+    std::vector<std::string> statements;
+    const HashAst ast = canonicalAst(src, magic, statements);
+
+    HashCost cost;
+    double hash_ready = 0.0;
+    for (const auto &n : ast) {
+        hash_ready = readyAt(*n, hash_ready, cost.operations);
+    }
+    cost.latency = hash_ready;
+    return cost;
+}
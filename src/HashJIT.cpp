@@ -0,0 +1,411 @@
+/**
+ * @file HashJIT.cpp
+ * @author Adam Freiberg (xfreib00@stud.fit.vutbr.cz)
+ * @brief Source file for HashJIT class methods
+ * @version 0.1
+ * @date 2021-07-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include "HashJIT.h"
+#include <cstring>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+/* x86-64 register numbers */
+enum Reg : uint8_t {
+    RAX = 0,
+    RCX = 1,
+    RDX = 2,
+    RBX = 3,
+    RSI = 6,
+    RDI = 7,
+    R8 = 8,
+    R9 = 9,
+    R10 = 10,
+    R11 = 11,
+    R12 = 12,
+    R13 = 13,
+    R14 = 14,
+    R15 = 15
+};
+
+/* registers holding bytecode stack slots, rcx is kept as scratch */
+constexpr Reg slots[] = {R8, R9, RDX, RBX, R12, R13, R14, R15};
+constexpr size_t slot_count = sizeof(slots) / sizeof(slots[0]);
+
+/* registers holding variables */
+constexpr Reg reg_hash = RAX;
+constexpr Reg reg_key = R11;
+constexpr Reg reg_magic = R10;
+
+/**
+ * @brief Minimal x86-64 instruction encoder.
+ */
+class Emitter {
+  public:
+    explicit Emitter(std::vector<uint8_t> &buffer) : out(buffer) {}
+
+    void byte(uint8_t b) { out.push_back(b); }
+
+    void imm32(uint32_t v) {
+        for (int i = 0; i < 4; i++) {
+            byte(static_cast<uint8_t>(v >> (8 * i)));
+        }
+    }
+
+    void imm64(uint64_t v) {
+        for (int i = 0; i < 8; i++) {
+            byte(static_cast<uint8_t>(v >> (8 * i)));
+        }
+    }
+
+    /* REX prefix, emitted only when needed */
+    void rex(bool w, uint8_t reg, uint8_t rm) {
+        const auto r = static_cast<uint8_t>(0x40 | (w ? 0x08 : 0) |
+                                            ((reg >> 3) << 2) | (rm >> 3));
+        if (r != 0x40) {
+            byte(r);
+        }
+    }
+
+    void modrm(uint8_t reg, uint8_t rm) {
+        byte(static_cast<uint8_t>(0xC0 | ((reg & 7) << 3) | (rm & 7)));
+    }
+
+    /* op dst, src for add/or/and/sub/xor/mov */
+    void alu(uint8_t opcode, Reg dst, Reg src, bool w = true) {
+        rex(w, src, dst);
+        byte(opcode);
+        modrm(src, dst);
+    }
+
+    /* op dst, imm32 (sign-extended) for add/or/and/sub/xor */
+    void aluImm(uint8_t ext, Reg dst, uint32_t imm) {
+        rex(true, 0, dst);
+        byte(0x81);
+        modrm(ext, dst);
+        imm32(imm);
+    }
+
+    void imul(Reg dst, Reg src) {
+        rex(true, dst, src);
+        byte(0x0F);
+        byte(0xAF);
+        modrm(dst, src);
+    }
+
+    void imulImm(Reg dst, uint32_t imm) {
+        rex(true, dst, dst);
+        byte(0x69);
+        modrm(dst, dst);
+        imm32(imm);
+    }
+
+    /* not/neg */
+    void unary(uint8_t ext, Reg dst) {
+        rex(true, 0, dst);
+        byte(0xF7);
+        modrm(ext, dst);
+    }
+
+    /* shl/shr/sar by cl */
+    void shiftCl(uint8_t ext, Reg dst) {
+        rex(true, 0, dst);
+        byte(0xD3);
+        modrm(ext, dst);
+    }
+
+    void shiftImm(uint8_t ext, Reg dst, uint8_t count) {
+        rex(true, 0, dst);
+        byte(0xC1);
+        modrm(ext, dst);
+        byte(count);
+    }
+
+    /* mov dst32, src32 which zero-extends to 64 bits */
+    void movZx32(Reg dst, Reg src) { alu(0x89, dst, src, false); }
+
+    /* movsxd dst, src32 */
+    void movSx32(Reg dst, Reg src) {
+        rex(true, dst, src);
+        byte(0x63);
+        modrm(dst, src);
+    }
+
+    /* load constant using shortest encoding */
+    void movImm(Reg dst, uint64_t v) {
+        if (v <= 0xFFFFFFFFull) {
+            rex(false, 0, dst);
+            byte(static_cast<uint8_t>(0xB8 + (dst & 7)));
+            imm32(static_cast<uint32_t>(v));
+        } else if (fitsImm32(v)) {
+            rex(true, 0, dst);
+            byte(0xC7);
+            modrm(0, dst);
+            imm32(static_cast<uint32_t>(v));
+        } else {
+            rex(true, 0, dst);
+            byte(static_cast<uint8_t>(0xB8 + (dst & 7)));
+            imm64(v);
+        }
+    }
+
+    /* check if value can be encoded as sign-extended 32-bit immediate */
+    static bool fitsImm32(uint64_t v) {
+        const auto s = static_cast<int64_t>(v);
+        return s >= INT32_MIN && s <= INT32_MAX;
+    }
+
+    size_t size(void) const { return out.size(); }
+
+    void patch32(size_t at, uint32_t v) {
+        for (size_t i = 0; i < 4; i++) {
+            out[at + i] = static_cast<uint8_t>(v >> (8 * i));
+        }
+    }
+
+  private:
+    std::vector<uint8_t> &out;
+};
+
+/* opcode of reg/reg form and extension of imm form of ALU operations */
+bool aluOpcode(HashVM::Op op, uint8_t &opcode, uint8_t &ext) {
+    switch (op) {
+    case HashVM::Op::Add:
+        opcode = 0x01;
+        ext = 0;
+        return true;
+    case HashVM::Op::Or:
+        opcode = 0x09;
+        ext = 1;
+        return true;
+    case HashVM::Op::And:
+        opcode = 0x21;
+        ext = 4;
+        return true;
+    case HashVM::Op::Sub:
+        opcode = 0x29;
+        ext = 5;
+        return true;
+    case HashVM::Op::Xor:
+        opcode = 0x31;
+        ext = 6;
+        return true;
+    default:
+        return false;
+    }
+}
+
+} // namespace
+
+bool HashJIT::translate(const HashVM &vm, std::vector<uint8_t> &out) {
+    if (vm.empty() || vm.depth() > slot_count) {
+        return false;
+    }
+
+    Emitter e(out);
+
+    /* prologue, save callee-saved registers used as stack slots */
+    for (Reg r : {RBX, R12, R13, R14, R15}) {
+        e.rex(false, 0, r);
+        e.byte(static_cast<uint8_t>(0x50 + (r & 7)));
+    }
+    e.alu(0x89, reg_magic, RDX);
+    e.alu(0x31, reg_hash, reg_hash, false);
+    /* test rsi, rsi; jz epilogue */
+    e.alu(0x85, RSI, RSI);
+    e.byte(0x0F);
+    e.byte(0x84);
+    const size_t skip_at = e.size();
+    e.imm32(0);
+
+    /* loop over words of key: mov r11d, [rdi] */
+    const size_t loop = e.size();
+    e.byte(0x44);
+    e.byte(0x8B);
+    e.byte(0x1F);
+
+    size_t sp = 0;
+    for (const auto &i : vm.program()) {
+        /* resolve operand to register, or immediate value */
+        bool is_imm = false;
+        Reg src = RCX;
+        switch (i.src) {
+        case HashVM::Src::Stack:
+            src = slots[--sp];
+            break;
+        case HashVM::Src::Imm:
+            is_imm = true;
+            break;
+        case HashVM::Src::Hash:
+            src = reg_hash;
+            break;
+        case HashVM::Src::Key:
+            src = reg_key;
+            break;
+        case HashVM::Src::Magic:
+            src = reg_magic;
+            break;
+        case HashVM::Src::None:
+            break;
+        }
+
+        if (i.op == HashVM::Op::Push) {
+            if (is_imm) {
+                e.movImm(slots[sp], i.imm);
+            } else {
+                e.alu(0x89, slots[sp], src);
+            }
+            sp++;
+            continue;
+        }
+        if (i.op == HashVM::Op::Store) {
+            e.alu(0x89, reg_hash, src);
+            continue;
+        }
+
+        const Reg dst = slots[sp - 1];
+        uint8_t opcode = 0, ext = 0;
+
+        switch (i.op) {
+        case HashVM::Op::Not:
+            e.unary(2, dst);
+            break;
+        case HashVM::Op::Neg:
+            e.unary(3, dst);
+            break;
+        case HashVM::Op::Trunc:
+            e.movZx32(dst, dst);
+            break;
+        case HashVM::Op::Sext:
+            e.movSx32(dst, dst);
+            break;
+        case HashVM::Op::Add:
+        case HashVM::Op::Sub:
+        case HashVM::Op::And:
+        case HashVM::Op::Or:
+        case HashVM::Op::Xor:
+            aluOpcode(i.op, opcode, ext);
+            if (is_imm && Emitter::fitsImm32(i.imm)) {
+                e.aluImm(ext, dst, static_cast<uint32_t>(i.imm));
+            } else {
+                if (is_imm) {
+                    e.movImm(RCX, i.imm);
+                }
+                e.alu(opcode, dst, src);
+            }
+            break;
+        case HashVM::Op::Mul:
+            if (is_imm && Emitter::fitsImm32(i.imm)) {
+                e.imulImm(dst, static_cast<uint32_t>(i.imm));
+            } else {
+                if (is_imm) {
+                    e.movImm(RCX, i.imm);
+                }
+                e.imul(dst, src);
+            }
+            break;
+        case HashVM::Op::Shl:
+        case HashVM::Op::Shr:
+        case HashVM::Op::Sar:
+            ext = i.op == HashVM::Op::Shl   ? 4
+                  : i.op == HashVM::Op::Shr ? 5
+                                            : 7;
+            if (is_imm) {
+                if (const auto count = static_cast<uint8_t>(i.imm & i.mask);
+                    count != 0) {
+                    e.shiftImm(ext, dst, count);
+                }
+            } else {
+                e.alu(0x89, RCX, src);
+                if (i.mask != 63) {
+                    /* and ecx, mask */
+                    e.byte(0x83);
+                    e.byte(0xE1);
+                    e.byte(i.mask);
+                }
+                e.shiftCl(ext, dst);
+            }
+            break;
+        default:
+            /* division needs rax and rdx and may trap, leave it to HashVM */
+            return false;
+        }
+    }
+
+    /* add rdi, 4; dec rsi; jnz loop */
+    e.byte(0x48);
+    e.byte(0x83);
+    e.byte(0xC7);
+    e.byte(0x04);
+    e.byte(0x48);
+    e.byte(0xFF);
+    e.byte(0xCE);
+    e.byte(0x0F);
+    e.byte(0x85);
+    e.imm32(static_cast<uint32_t>(loop - (e.size() + 4)));
+
+    /* epilogue */
+    e.patch32(skip_at, static_cast<uint32_t>(e.size() - (skip_at + 4)));
+    for (Reg r : {R15, R14, R13, R12, RBX}) {
+        e.rex(false, 0, r);
+        e.byte(static_cast<uint8_t>(0x58 + (r & 7)));
+    }
+    e.byte(0xC3);
+
+    return true;
+}
+
+bool HashJIT::compile(const HashVM &vm) {
+    func = nullptr;
+
+    if (!supported()) {
+        return false;
+    }
+
+    std::vector<uint8_t> code;
+    if (!translate(vm, code)) {
+        return false;
+    }
+
+    /* reuse mapping if it is large enough, otherwise allocate new one */
+    const auto page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t size = (code.size() + page - 1) / page * page;
+    if (size > mem_size) {
+        if (mem != nullptr) {
+            munmap(mem, mem_size);
+            mem = nullptr;
+            mem_size = 0;
+        }
+        void *m = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (m == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        mem = m;
+        mem_size = size;
+    } else if (mprotect(mem, mem_size, PROT_READ | PROT_WRITE) != 0) {
+        throw std::bad_alloc();
+    }
+
+    std::memcpy(mem, code.data(), code.size());
+
+    if (mprotect(mem, mem_size, PROT_READ | PROT_EXEC) != 0) {
+        throw std::bad_alloc();
+    }
+
+    func = reinterpret_cast<Function>(mem);
+    return true;
+}
+
+HashJIT::~HashJIT() {
+    if (mem != nullptr) {
+        munmap(mem, mem_size);
+    }
+}
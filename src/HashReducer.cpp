@@ -0,0 +1,114 @@
+/**
+ * @file HashReducer.cpp
+ * @author Adam Freiberg (xfreib00@stud.fit.vutbr.cz)
+ * @brief Source file for HashReducer class methods
+ * @version 0.1
+ * @date 2021-07-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include "HashReducer.h"
+#include <charconv>
+#include <sstream>
+
+/* trial division is fast enough for 32-bit numbers */
+static bool isPrime(uint64_t n) {
+    if (n < 2) {
+        return false;
+    }
+    for (uint64_t d = 2; d * d <= n; d++) {
+        if (n % d == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+HashReducer::HashReducer(Kind kind, uint64_t param)
+    : kind(kind), param(param) {
+    switch (kind) {
+    case Kind::Fold:
+    case Kind::MulShift:
+        if (param < 1 || param > 32) {
+            throw hashReducerError();
+        }
+        shift = static_cast<unsigned>(param);
+        mask = (static_cast<uint64_t>(1) << shift) - 1;
+        table_size = static_cast<size_t>(1) << shift;
+        break;
+    case Kind::Prime:
+        if (param >= (static_cast<uint64_t>(1) << 32) || !isPrime(param)) {
+            throw hashReducerError();
+        }
+        table_size = static_cast<size_t>(param);
+        break;
+    }
+}
+
+std::vector<HashReducer> HashReducer::parseList(const std::string &spec) {
+    std::vector<HashReducer> list;
+    std::stringstream ss(spec);
+    std::string item;
+
+    while (std::getline(ss, item, ',')) {
+        const auto colon = item.find(':');
+        if (colon == std::string::npos) {
+            throw hashReducerError();
+        }
+        const std::string kind = item.substr(0, colon);
+
+        uint64_t param = 0;
+        const char *first = item.data() + colon + 1;
+        const char *last = item.data() + item.size();
+        auto [ptr, ec] = std::from_chars(first, last, param);
+        if (ec != std::errc() || ptr != last || first == last) {
+            throw hashReducerError();
+        }
+
+        if (kind == "fold") {
+            list.emplace_back(Kind::Fold, param);
+        } else if (kind == "prime") {
+            list.emplace_back(Kind::Prime, param);
+        } else if (kind == "mulshift") {
+            list.emplace_back(Kind::MulShift, param);
+        } else {
+            throw hashReducerError();
+        }
+    }
+
+    if (list.empty()) {
+        throw hashReducerError();
+    }
+    return list;
+}
+
+std::string HashReducer::name(void) const {
+    switch (kind) {
+    case Kind::Fold:
+        return "fold" + std::to_string(param);
+    case Kind::Prime:
+        return "prime" + std::to_string(param);
+    case Kind::MulShift:
+        return "mulshift" + std::to_string(param);
+    }
+    return "";
+}
+
+std::string HashReducer::expression(const std::string &hash) const {
+    std::stringstream ss;
+    switch (kind) {
+    case Kind::Fold:
+        ss << "((" << hash << " >> " << shift << ") ^ " << hash << ") & 0x"
+           << std::hex << mask << "ull";
+        break;
+    case Kind::Prime:
+        ss << hash << " % " << param << "ull";
+        break;
+    case Kind::MulShift:
+        ss << "(" << hash << " * 0x9e3779b97f4a7c15ull) >> " << 64 - shift;
+        break;
+    }
+    return ss.str();
+}
@@ -0,0 +1,203 @@
+/**
+ * @file HashSIMD.cpp
+ * @author Adam Freiberg (xfreib00@stud.fit.vutbr.cz)
+ * @brief Source file for HashSIMD class methods
+ * @version 0.1
+ * @date 2021-07-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include "HashSIMD.h"
+#include <algorithm>
+#include <cstring>
+
+using Op = HashVM::Op;
+using Src = HashVM::Src;
+
+static constexpr size_t L = HashSIMD::lanes;
+
+/* apply operation to all lanes, loop is vectorized by compiler */
+#define LANES(expr)                                                            \
+    for (size_t l = 0; l < L; l++) {                                           \
+        expr;                                                                  \
+    }
+
+/* hash one block of keys, soa holds word w of key l at soa[w * L + l] */
+[[gnu::always_inline]] static inline void
+block(const std::vector<HashVM::Instr> &code, const uint32_t *soa, size_t words,
+      uint64_t magic, uint64_t *stack, uint64_t *out) {
+    alignas(64) uint64_t hash[L] = {};
+    alignas(64) uint64_t top[L] = {};
+    alignas(64) uint64_t key[L];
+    alignas(64) uint64_t imm[L];
+
+    for (size_t w = 0; w < words; w++) {
+        LANES(key[l] = soa[w * L + l]);
+        uint64_t *sp = stack;
+
+        for (const HashVM::Instr &i : code) {
+            /* fetch operand */
+            const uint64_t *b = imm;
+            switch (i.src) {
+            case Src::Stack:
+                /* operand is current top, new top is popped from stack */
+                std::memcpy(imm, top, sizeof(top));
+                sp -= L;
+                std::memcpy(top, sp, sizeof(top));
+                break;
+            case Src::Imm:
+                LANES(imm[l] = i.imm);
+                break;
+            case Src::Hash:
+                b = hash;
+                break;
+            case Src::Key:
+                b = key;
+                break;
+            case Src::Magic:
+                LANES(imm[l] = magic);
+                break;
+            case Src::None:
+                break;
+            }
+
+            switch (i.op) {
+            case Op::Push:
+                std::memcpy(sp, top, sizeof(top));
+                sp += L;
+                std::memcpy(top, b, sizeof(top));
+                break;
+            case Op::Store:
+                std::memcpy(hash, b, sizeof(hash));
+                break;
+            case Op::Not:
+                LANES(top[l] = ~top[l]);
+                break;
+            case Op::Neg:
+                LANES(top[l] = 0 - top[l]);
+                break;
+            case Op::Trunc:
+                LANES(top[l] &= 0xFFFFFFFFull);
+                break;
+            case Op::Sext:
+                LANES(top[l] = static_cast<uint64_t>(
+                          static_cast<int64_t>(static_cast<int32_t>(top[l]))));
+                break;
+            case Op::Add:
+                LANES(top[l] += b[l]);
+                break;
+            case Op::Sub:
+                LANES(top[l] -= b[l]);
+                break;
+            case Op::Mul:
+                LANES(top[l] *= b[l]);
+                break;
+            case Op::DivU:
+            case Op::ModU:
+            case Op::DivS:
+            case Op::ModS:
+                /* no vector division, it is rare in evolved functions */
+                for (size_t l = 0; l < L; l++) {
+                    top[l] = HashVM::divide(i.op, top[l], b[l]);
+                }
+                break;
+            case Op::And:
+                LANES(top[l] &= b[l]);
+                break;
+            case Op::Or:
+                LANES(top[l] |= b[l]);
+                break;
+            case Op::Xor:
+                LANES(top[l] ^= b[l]);
+                break;
+            case Op::Shl:
+                LANES(top[l] <<= (b[l] & i.mask));
+                break;
+            case Op::Shr:
+                LANES(top[l] >>= (b[l] & i.mask));
+                break;
+            case Op::Sar:
+                LANES(top[l] = static_cast<uint64_t>(
+                          static_cast<int64_t>(top[l]) >> (b[l] & i.mask)));
+                break;
+            }
+        }
+    }
+
+    std::memcpy(out, hash, sizeof(hash));
+}
+
+#undef LANES
+
+#if defined(__x86_64__)
+[[gnu::target("avx512f,avx512dq,avx512vl")]] static void
+blockAVX512(const std::vector<HashVM::Instr> &code,
+            const uint32_t *soa, size_t words, uint64_t magic,
+            uint64_t *stack, uint64_t *out) {
+    block(code, soa, words, magic, stack, out);
+}
+
+[[gnu::target("avx2")]] static void
+blockAVX2(const std::vector<HashVM::Instr> &code,
+          const uint32_t *soa, size_t words, uint64_t magic, uint64_t *stack,
+          uint64_t *out) {
+    block(code, soa, words, magic, stack, out);
+}
+#endif
+
+static void blockGeneric(const std::vector<HashVM::Instr> &code,
+                         const uint32_t *soa, size_t words, uint64_t magic,
+                         uint64_t *stack, uint64_t *out) {
+    block(code, soa, words, magic, stack, out);
+}
+
+HashSIMD::HashSIMD() : kernel(blockGeneric), isa_name("generic") {
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") &&
+        __builtin_cpu_supports("avx512dq") &&
+        __builtin_cpu_supports("avx512vl")) {
+        kernel = blockAVX512;
+        isa_name = "avx512";
+    } else if (__builtin_cpu_supports("avx2")) {
+        kernel = blockAVX2;
+        isa_name = "avx2";
+    }
+#endif
+}
+
+void HashSIMD::compile(const HashVM &vm) {
+    code = vm.program();
+}
+
+void HashSIMD::run(const uint32_t *keys, size_t count, size_t words,
+                   uint64_t magic, uint64_t *out) const {
+    if (count == 0) {
+        return;
+    }
+
+    /* one slot over maximal depth, top of empty stack is pushed too, both
+     * buffers are sized for the largest program and key, so nothing is
+     * allocated and concurrent calls do not share state */
+    alignas(64) uint64_t stack[(HashVM::max_stack + 1) * lanes];
+    alignas(64) uint32_t soa[max_words * lanes];
+    alignas(64) uint64_t result[lanes];
+
+    for (size_t first = 0; first < count; first += lanes) {
+        const size_t n = std::min(lanes, count - first);
+
+        /* transpose block, missing keys of last block are replaced by its
+         * first key, so they can not fail where real keys do not */
+        for (size_t l = 0; l < lanes; l++) {
+            const uint32_t *k = keys + (first + (l < n ? l : 0)) * words;
+            for (size_t w = 0; w < words; w++) {
+                soa[w * lanes + l] = k[w];
+            }
+        }
+
+        kernel(code, soa, words, magic, stack, result);
+        std::copy(result, result + n, out + first);
+    }
+}
@@ -0,0 +1,273 @@
+/**
+ * @file HashVM.cpp
+ * @author Adam Freiberg (xfreib00@stud.fit.vutbr.cz)
+ * @brief Source file for HashVM class methods
+ * @version 0.1
+ * @date 2021-07-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include "HashVM.h"
+
+/* get operand source for leaf node, None if node is not a leaf */
+static HashVM::Src leafSource(const HashNode &n) {
+    switch (n.op) {
+    case HashOp::Const:
+        return HashVM::Src::Imm;
+    case HashOp::Hash:
+        return HashVM::Src::Hash;
+    case HashOp::Key:
+        return HashVM::Src::Key;
+    case HashOp::Magic:
+        return HashVM::Src::Magic;
+    default:
+        return HashVM::Src::None;
+    }
+}
+
+/* map expression operation to bytecode operation for given type */
+static HashVM::Op binaryOp(HashOp op, HashType type) {
+    const bool s = isSigned(type);
+    switch (op) {
+    case HashOp::Add:
+        return HashVM::Op::Add;
+    case HashOp::Sub:
+        return HashVM::Op::Sub;
+    case HashOp::Mul:
+        return HashVM::Op::Mul;
+    case HashOp::Div:
+        return s ? HashVM::Op::DivS : HashVM::Op::DivU;
+    case HashOp::Mod:
+        return s ? HashVM::Op::ModS : HashVM::Op::ModU;
+    case HashOp::And:
+        return HashVM::Op::And;
+    case HashOp::Or:
+        return HashVM::Op::Or;
+    case HashOp::Xor:
+        return HashVM::Op::Xor;
+    case HashOp::Shl:
+        return HashVM::Op::Shl;
+    case HashOp::Shr:
+        return s ? HashVM::Op::Sar : HashVM::Op::Shr;
+    default:
+        throw hashCompileError();
+    }
+}
+
+/* division is kept out of interpreter loop, it is rare and may throw */
+uint64_t HashVM::divide(Op op, uint64_t a, uint64_t b) {
+    if (b == 0) {
+        throw hashArithmeticError();
+    }
+    switch (op) {
+    case HashVM::Op::DivU:
+        return a / b;
+    case HashVM::Op::ModU:
+        return a % b;
+    default:
+        break;
+    }
+    /* avoid trap on minimal value divided by -1 */
+    if (static_cast<int64_t>(b) == -1) {
+        return op == HashVM::Op::DivS ? 0 - a : 0;
+    }
+    const auto sa = static_cast<int64_t>(a);
+    const auto sb = static_cast<int64_t>(b);
+    return static_cast<uint64_t>(op == HashVM::Op::DivS ? sa / sb : sa % sb);
+}
+
+void HashVM::compile(const std::string &func) {
+    HashParser parser;
+    compile(parser.parse(func));
+}
+
+void HashVM::compile(const HashAst &ast) {
+    code.clear();
+    cur_depth = 0;
+    max_depth = 0;
+
+    try {
+        for (const auto &stmt : ast) {
+            emit(*stmt);
+            /* store result to hash, value is already canonical */
+            append(Op::Store, Src::Stack);
+        }
+    } catch (...) {
+        code.clear();
+        throw;
+    }
+
+    if (max_depth > max_stack) {
+        code.clear();
+        throw hashCompileError();
+    }
+
+    result_type = ast.empty() ? HashType::UInt64 : ast.back()->type;
+}
+
+void HashVM::append(Op op, Src src, uint64_t imm, uint8_t mask) {
+    code.push_back({op, src, mask, imm});
+
+    if (op == Op::Push) {
+        cur_depth++;
+    } else if (src == Src::Stack) {
+        cur_depth--;
+    }
+    if (cur_depth > max_depth) {
+        max_depth = cur_depth;
+    }
+}
+
+void HashVM::convert(HashType from, HashType to) {
+    /* only conversion changing canonical form is signed to unsigned 32-bit */
+    if (from == HashType::Int32 && to == HashType::UInt32) {
+        append(Op::Trunc);
+    }
+}
+
+void HashVM::emit(const HashNode &n) {
+    /* fold constant subexpressions */
+    if (uint64_t value; constantValue(n, value)) {
+        append(Op::Push, Src::Imm, value);
+        return;
+    }
+
+    if (Src src = leafSource(n); src != Src::None) {
+        append(Op::Push, src);
+        return;
+    }
+
+    /* normalization of 32-bit result after operations which may overflow */
+    const Op norm = n.type == HashType::Int32 ? Op::Sext : Op::Trunc;
+
+    if (!n.rhs) {
+        emit(*n.lhs);
+        append(n.op == HashOp::Not ? Op::Not : Op::Neg);
+        if (isNarrow(n.type)) {
+            append(norm);
+        }
+        return;
+    }
+
+    emit(*n.lhs);
+    convert(n.lhs->type, n.type);
+
+    /* leaf right operand is read directly by instruction */
+    Src src = leafSource(*n.rhs);
+    uint64_t imm = 0;
+    if (uint64_t value; constantValue(*n.rhs, value)) {
+        src = Src::Imm;
+        imm = canonical(n.type, value);
+    } else if (src == Src::None) {
+        emit(*n.rhs);
+        convert(n.rhs->type, n.type);
+        src = Src::Stack;
+    }
+
+    const Op op = binaryOp(n.op, n.type);
+    append(op, src, imm, isNarrow(n.type) ? 31 : 63);
+
+    if (isNarrow(n.type) && op != Op::And && op != Op::Or && op != Op::Xor &&
+        op != Op::Shr && op != Op::Sar && op != Op::DivU && op != Op::ModU) {
+        append(norm);
+    }
+}
+
+uint64_t HashVM::run(const uint32_t *key, size_t words, uint64_t magic) const {
+    /* top of stack is cached in local variable, so memory is touched only
+     * when value is pushed over it */
+    uint64_t stack[max_stack + 1];
+    uint64_t top = 0;
+    uint64_t hash = 0;
+
+    for (size_t w = 0; w < words; w++) {
+        const uint64_t k = key[w];
+        uint64_t *sp = stack;
+
+        for (const Instr &i : code) {
+            /* fetch operand */
+            uint64_t b = 0;
+            switch (i.src) {
+            case Src::Stack:
+                b = top;
+                top = *--sp;
+                break;
+            case Src::Imm:
+                b = i.imm;
+                break;
+            case Src::Hash:
+                b = hash;
+                break;
+            case Src::Key:
+                b = k;
+                break;
+            case Src::Magic:
+                b = magic;
+                break;
+            case Src::None:
+                break;
+            }
+
+            switch (i.op) {
+            case Op::Push:
+                *sp++ = top;
+                top = b;
+                break;
+            case Op::Store:
+                hash = b;
+                break;
+            case Op::Not:
+                top = ~top;
+                break;
+            case Op::Neg:
+                top = 0 - top;
+                break;
+            case Op::Trunc:
+                top &= 0xFFFFFFFFull;
+                break;
+            case Op::Sext:
+                top = static_cast<uint64_t>(
+                    static_cast<int64_t>(static_cast<int32_t>(top)));
+                break;
+            case Op::Add:
+                top += b;
+                break;
+            case Op::Sub:
+                top -= b;
+                break;
+            case Op::Mul:
+                top *= b;
+                break;
+            case Op::DivU:
+            case Op::ModU:
+            case Op::DivS:
+            case Op::ModS:
+                top = divide(i.op, top, b);
+                break;
+            case Op::And:
+                top &= b;
+                break;
+            case Op::Or:
+                top |= b;
+                break;
+            case Op::Xor:
+                top ^= b;
+                break;
+            case Op::Shl:
+                top <<= (b & i.mask);
+                break;
+            case Op::Shr:
+                top >>= (b & i.mask);
+                break;
+            case Op::Sar:
+                top = static_cast<uint64_t>(static_cast<int64_t>(top) >>
+                                            (b & i.mask));
+                break;
+            }
+        }
+    }
+
+    return hash;
+}
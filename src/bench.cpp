@@ -0,0 +1,507 @@
+/**
+ * @file bench.cpp
+ * @author Adam Freiberg (xfreib00@stud.fit.vutbr.cz)
+ * @brief Benchmarks of evaluation hot path
+ * @version 0.1
+ * @date 2021-07-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include "GEDataset.h"
+#include "GEDriver.h"
+#include "GEEvaluator.h"
+#include "GELogger.h"
+#include "GERandom.h"
+#include "HTable.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <getopt.h>
+#include <gram/language/parser/BnfRuleParser.h>
+#include <gram/operator/crossover/OnePointCrossover.h>
+#include <gram/operator/mutation/BernoulliStepGenerator.h>
+#include <gram/operator/mutation/CodonMutation.h>
+#include <gram/operator/selector/TournamentSelector.h>
+#include <gram/operator/selector/comparer/LowFitnessComparer.h>
+#include <gram/population/initializer/RandomInitializer.h>
+#include <gram/population/reproducer/PassionateReproducer.h>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+/* grammar of population and logger benchmarks */
+static const char *bench_grammar =
+    "<start> ::= <stmt> | <stmt> <start>\n"
+    "<stmt> ::= \"hash = \" <expr> \";\"\n"
+    "<expr> ::= <expr> <op> <expr> | \"(\" <expr> \")\" | \"~\" <expr> | "
+    "<var> | <const>\n"
+    "<op> ::= \"+\" | \"-\" | \"*\" | \"^\" | \"&\" | \"|\" | \"<<\" | "
+    "\">>\"\n"
+    "<var> ::= \"hash\" | \"key\" | \"magic\"\n"
+    "<const> ::= \"1\" | \"3\" | \"5\" | \"7\" | \"13\" | \"31\"\n";
+
+/* functions of hashing and evaluation benchmarks, from cheap to expensive */
+static const std::vector<std::string> bench_functions = {
+    "hash = hash * 31 + key;",
+    "hash = ~(hash+(~(key)^key<<3)+hash);",
+    "hash = (hash ^ key) * magic; hash = hash ^ (hash >> 29);",
+    "hash = hash + key; hash = hash ^ (hash << 10); hash = hash ^ (hash >> "
+    "6); hash = hash * 2654435761u; hash = hash ^ (hash >> 16) % 65521;",
+};
+
+static constexpr uint64_t bench_magic = 0xCBF29CE484222325ull;
+
+static void display_help() {
+    std::cout
+        << '\n'
+        << "Usage: gehash-bench [OPTIONS] ... [DATASET] ...\n"
+        << "Measure throughput of hashing, evaluation, dataset loading and "
+           "logging on synthetic keys and given training data files.\n"
+        << "Example: gehash-bench -o bench.json "
+           "data/train_set/train_set.data\n"
+        << "OPTIONS:\n"
+        << "\t -h, --help\t\t Display help.\n"
+        << "\t -o  --output\t\t Write results as JSON to file instead of "
+           "standard output.\n"
+        << "\t -c  --compare\t\t Compare results with baseline JSON file, "
+           "exit with failure on regression.\n"
+        << "\t -t  --tolerance\t Relative slowdown reported as regression. "
+           "Defaults to 0.1.\n"
+        << "\t -r  --repetitions\t Number of measurements of each benchmark, "
+           "median is reported. Defaults to 5.\n"
+        << "\t -k  --keys\t\t Number of keys of synthetic datasets. Defaults "
+           "to 100000.\n\n";
+}
+
+/**
+ * @brief Result of single benchmark.
+ */
+struct BenchResult {
+    /// Unique name, used for comparison with baseline.
+    std::string name;
+    /// Unit of value.
+    std::string unit;
+    /// Median of measurements.
+    double value;
+    /// True for rates, false for times.
+    bool higher_is_better;
+    /// All measurements.
+    std::vector<double> samples;
+};
+
+/**
+ * @brief Runner collecting benchmark results.
+ */
+class BenchRunner {
+  public:
+    explicit BenchRunner(size_t repetitions) : repetitions(repetitions){};
+
+    /**
+     * @brief Run measurement repeatedly and store its median.
+     * @param [in] name Name of benchmark.
+     * @param [in] unit Unit of measured value.
+     * @param [in] higher_is_better Direction of improvement.
+     * @param [in] measure Function performing single measurement, first
+     * call is warm-up and is not recorded.
+     */
+    void run(const std::string &name, const std::string &unit,
+             bool higher_is_better, const std::function<double()> &measure) {
+        measure();
+        std::vector<double> samples;
+        for (size_t i = 0; i < repetitions; i++) {
+            samples.push_back(measure());
+        }
+        std::vector<double> sorted = samples;
+        std::sort(sorted.begin(), sorted.end());
+        const double median = sorted[sorted.size() / 2];
+        results.push_back({name, unit, median, higher_is_better, samples});
+        std::cerr << name << ": " << median << " " << unit << std::endl;
+    };
+
+    /// Collected results.
+    std::vector<BenchResult> results;
+
+  private:
+    /// Number of recorded measurements.
+    size_t repetitions;
+};
+
+/* hash values are stored, so hashing can not be optimized out */
+static volatile uint64_t bench_sink;
+
+static double seconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/* write synthetic training data in text format */
+static void writeSynthetic(const std::string &path, size_t keys,
+                           bool subnet) {
+    std::ofstream f(path, std::ios::out | std::ios::trunc);
+    uint64_t state = subnet ? 2 : 1;
+    for (size_t i = 0; i < keys; i++) {
+        uint32_t w[10];
+        if (subnet) {
+            /* few /64 prefixes, sequential interface ids and ports, which
+             * resembles captured traffic */
+            const uint64_t r = splitmix64(state++);
+            w[0] = 0x20010db8u;
+            w[1] = static_cast<uint32_t>(r & 0x3);
+            w[2] = 0;
+            w[3] = static_cast<uint32_t>(i / 256);
+            w[4] = 0x20010db8u;
+            w[5] = 0x100u;
+            w[6] = 0;
+            w[7] = static_cast<uint32_t>(i % 4096);
+            w[8] = static_cast<uint32_t>(1024 + (r >> 8) % 64512);
+            w[9] = (r >> 32) & 1 ? 443 : 80;
+        } else {
+            for (size_t j = 0; j < 8; j++) {
+                w[j] = static_cast<uint32_t>(splitmix64(state++));
+            }
+            w[8] = static_cast<uint32_t>(splitmix64(state++) & 0xFFFF);
+            w[9] = static_cast<uint32_t>(splitmix64(state++) & 0xFFFF);
+        }
+        for (size_t j = 0; j < 10; j++) {
+            f << w[j] << (j < 9 ? ';' : '\n');
+        }
+    }
+}
+
+/* random population mapped by grammar of benchmark */
+static gram::Population makePopulation(unsigned long size, uint64_t seed) {
+    using namespace gram;
+    auto selector = std::make_unique<TournamentSelector>(
+        5, std::make_unique<GENumberGenerator>(splitmix64(seed + 1)),
+        std::make_unique<LowFitnessComparer>());
+    auto crossover = std::make_unique<OnePointCrossover>(
+        std::make_unique<GENumberGenerator>(splitmix64(seed + 2)));
+    auto stepGen = std::make_unique<BernoulliStepGenerator>(
+        Probability(0.05),
+        std::make_unique<GENumberGenerator>(splitmix64(seed + 3)));
+    auto mutation = std::make_unique<CodonMutation>(
+        move(stepGen),
+        std::make_unique<GENumberGenerator>(splitmix64(seed + 4)));
+    auto repr = std::make_unique<PassionateReproducer>(
+        move(selector), move(crossover), move(mutation));
+    RandomInitializer in(
+        std::make_unique<GENumberGenerator>(splitmix64(seed + 5)), 100);
+    return in.initialize(size, move(repr));
+}
+
+static std::unique_ptr<gram::ContextFreeMapper> makeMapper(void) {
+    gram::BnfRuleParser parser;
+    return std::make_unique<gram::ContextFreeMapper>(
+        std::make_unique<gram::ContextFreeGrammar>(
+            parser.parse(bench_grammar)),
+        3);
+}
+
+static void benchDataset(BenchRunner &b, const std::string &set,
+                         const std::string &text, const std::string &binary) {
+    b.run("load/text/" + set, "keys/s", true, [&]() {
+        GEDataset d(text);
+        return static_cast<double>(d.size()) / d.loadTime();
+    });
+    b.run("load/binary/" + set, "keys/s", true, [&]() {
+        GEDataset d(binary);
+        return static_cast<double>(d.size()) / d.loadTime();
+    });
+}
+
+static void benchHash(BenchRunner &b, const std::string &set,
+                      const GEDataset &data,
+                      const std::vector<std::pair<std::string, HashEngine>>
+                          &engines) {
+    using Table = HTable<16, GEDataset::Key>;
+    std::vector<uint64_t> out(Table::batch);
+
+    for (const auto &[engine_name, engine] : engines) {
+        /* ChaiScript is orders of magnitude slower, use fewer keys */
+        const size_t keys = engine == HashEngine::ChaiScript
+                                ? std::min<size_t>(data.size(), 2000)
+                                : data.size();
+        b.run("hash/" + engine_name + "/" + set, "keys/s", true, [&]() {
+            double time = 0.0;
+            uint64_t sink = 0;
+            for (const auto &f : bench_functions) {
+                Table table;
+                table.setCountOnly(true);
+                table.setEngine(engine);
+                table.setMagic(bench_magic);
+                table.setFunc(f);
+
+                const auto start = Clock::now();
+                for (size_t i = 0; i < keys; i += Table::batch) {
+                    const size_t n = std::min(Table::batch, keys - i);
+                    table.HashRaw(data.begin() + i, n, out.data());
+                    sink += out[n - 1];
+                }
+                time += seconds(start);
+            }
+            bench_sink = sink;
+            return static_cast<double>(keys * bench_functions.size()) / time;
+        });
+    }
+}
+
+static void benchEvaluate(BenchRunner &b, const std::string &set,
+                          const std::shared_ptr<const GEDataset> &data,
+                          const std::vector<std::pair<std::string, HashEngine>>
+                              &engines) {
+    for (const auto &[engine_name, engine] : engines) {
+        if (engine == HashEngine::ChaiScript) {
+            continue;
+        }
+        for (bool useSum : {false, true}) {
+            GEEvaluator<16> eval(bench_magic, data, useSum, engine);
+            const std::string fit = useSum ? "sum" : "nosum";
+            b.run("evaluate/" + engine_name + "/" + fit + "/" + set, "keys/s",
+                  true, [&]() {
+                      const auto start = Clock::now();
+                      for (const auto &f : bench_functions) {
+                          eval.evaluate(f);
+                      }
+                      return static_cast<double>(data->size() *
+                                                 bench_functions.size()) /
+                             seconds(start);
+                  });
+        }
+    }
+}
+
+static void benchPopulation(BenchRunner &b, const std::string &set,
+                            const std::shared_ptr<const GEDataset> &data) {
+    for (unsigned long size : {25ul, 100ul, 400ul}) {
+        gram::Population population = makePopulation(size, size);
+        b.run("population/" + std::to_string(size) + "/" + set,
+              "individuals/s", true, [&]() {
+                  /* new driver, so fitness cache is empty */
+                  std::vector<std::unique_ptr<GEEvaluatorBase>> evals;
+                  evals.push_back(std::make_unique<GEEvaluator<16>>(
+                      bench_magic, data, false, HashEngine::VM));
+                  GEDriver driver(makeMapper(), std::move(evals));
+                  driver.setCanonical(bench_magic);
+
+                  const auto start = Clock::now();
+                  driver.evaluate(population.allIndividuals());
+                  return static_cast<double>(size) / seconds(start);
+              });
+    }
+}
+
+static void benchLogger(BenchRunner &b, const std::string &dir,
+                        const std::shared_ptr<const GEDataset> &data) {
+    constexpr size_t generations = 1000;
+
+    gram::Population population = makePopulation(200, 1);
+    std::vector<std::unique_ptr<GEEvaluatorBase>> evals;
+    evals.push_back(std::make_unique<GEEvaluator<16>>(bench_magic, data,
+                                                      false, HashEngine::VM));
+    GEDriver driver(makeMapper(), std::move(evals));
+    driver.evaluate(population.allIndividuals());
+
+    for (bool stream : {false, true}) {
+        const std::string mode = stream ? "ndjson" : "json";
+        const std::string path = dir + "/logger." + mode;
+
+        /* time spent by evolution thread and time until output is complete */
+        double enqueue = 0.0;
+        auto run = [&]() {
+            GELogger log(path, makeMapper());
+            log.setDebug(true);
+            log.setStreaming(stream);
+
+            const auto start = Clock::now();
+            for (size_t g = 0; g < generations; g++) {
+                log.logProgress(population);
+            }
+            enqueue = seconds(start) * 1e6 / generations;
+            log.logResult(population);
+            return seconds(start) * 1e6 / generations;
+        };
+
+        b.run("logger/" + mode + "/enqueue", "us/gen", false, [&]() {
+            run();
+            return enqueue;
+        });
+        b.run("logger/" + mode + "/total", "us/gen", false, run);
+        std::filesystem::remove(path);
+    }
+}
+
+/* compare results with baseline, return number of regressions */
+static size_t compare(const std::vector<BenchResult> &results,
+                      const json &baseline, double tolerance) {
+    size_t regressions = 0;
+    for (const auto &r : results) {
+        const json *old = nullptr;
+        for (const auto &o : baseline.at("benchmarks")) {
+            if (o.at("name") == r.name) {
+                old = &o;
+                break;
+            }
+        }
+        if (!old) {
+            std::fprintf(stderr, "%-40s %14s %14.4g  new\n", r.name.c_str(),
+                         "-", r.value);
+            continue;
+        }
+
+        const double before = old->at("value").get<double>();
+        /* ratio over 1 is improvement */
+        const double ratio =
+            r.higher_is_better ? r.value / before : before / r.value;
+        const bool regression = ratio < 1.0 - tolerance;
+        regressions += regression;
+        std::fprintf(stderr, "%-40s %14.4g %14.4g  %+6.1f%%%s\n",
+                     r.name.c_str(), before, r.value, (ratio - 1.0) * 100.0,
+                     regression ? "  REGRESSION" : "");
+    }
+    return regressions;
+}
+
+int main(int argc, char **argv) {
+
+    int c = 0;
+    struct option longopts[] = {
+        {"output", required_argument, nullptr, 'o'},
+        {"compare", required_argument, nullptr, 'c'},
+        {"tolerance", required_argument, nullptr, 't'},
+        {"repetitions", required_argument, nullptr, 'r'},
+        {"keys", required_argument, nullptr, 'k'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0}};
+
+    std::string output;
+    std::string baseline_path;
+    double tolerance = 0.1;
+    unsigned long repetitions = 5;
+    unsigned long keys = 100000;
+
+    while ((c = getopt_long(argc, argv, ":o:c:t:r:k:h", longopts, nullptr)) !=
+           -1) {
+        try {
+            switch (c) {
+            case 'o':
+                output = optarg;
+                break;
+            case 'c':
+                baseline_path = optarg;
+                break;
+            case 't':
+                tolerance = std::stod(optarg);
+                break;
+            case 'r':
+                repetitions = std::max(std::stoul(optarg, nullptr, 0), 1ul);
+                break;
+            case 'k':
+                keys = std::max(std::stoul(optarg, nullptr, 0), 1ul);
+                break;
+            case 'h':
+                display_help();
+                std::exit(EXIT_SUCCESS);
+            default:
+                std::cerr << "Invalid input, use --help option"
+                             " to display help."
+                          << std::endl;
+                std::exit(EXIT_FAILURE);
+            }
+        } catch (std::logic_error &e) {
+            std::cerr << "Invalid input, use --help option"
+                         " to display help."
+                      << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    std::vector<std::pair<std::string, HashEngine>> engines = {
+        {"vm", HashEngine::VM}, {"jit", HashEngine::JIT},
+        {"simd", HashEngine::SIMD}};
+#ifdef GEHASH_USE_CHAISCRIPT
+    engines.emplace_back("chai", HashEngine::ChaiScript);
+#endif
+
+    try {
+        json baseline;
+        if (!baseline_path.empty()) {
+            std::ifstream f(baseline_path);
+            baseline = json::parse(f);
+        }
+
+        const std::string dir =
+            (std::filesystem::temp_directory_path() /
+             ("gehash-bench-" + std::to_string(::getpid())))
+                .string();
+        std::filesystem::create_directories(dir);
+
+        /* synthetic datasets are fixed for given number of keys, sample
+         * datasets are given on command line */
+        std::vector<std::pair<std::string, std::string>> sets = {
+            {"synthetic-random", dir + "/random.data"},
+            {"synthetic-subnet", dir + "/subnet.data"}};
+        writeSynthetic(sets[0].second, keys, false);
+        writeSynthetic(sets[1].second, keys, true);
+        for (int i = optind; i < argc; i++) {
+            sets.emplace_back(
+                std::filesystem::path(argv[i]).stem().string(), argv[i]);
+        }
+
+        BenchRunner b(repetitions);
+        for (const auto &[set, path] : sets) {
+            auto data = std::make_shared<const GEDataset>(path);
+            const std::string binary = dir + "/" + set + ".bin";
+            data->save(binary);
+
+            benchDataset(b, set, path, binary);
+            benchHash(b, set, *data, engines);
+            benchEvaluate(b, set, data, engines);
+            benchPopulation(b, set, data);
+            std::filesystem::remove(binary);
+        }
+        benchLogger(b, dir,
+                    std::make_shared<const GEDataset>(sets[0].second));
+        std::filesystem::remove_all(dir);
+
+        json j;
+        j["gehash_bench"] = 1;
+        j["config"] = {{"keys", keys},
+                       {"repetitions", repetitions},
+                       {"functions", bench_functions}};
+        for (const auto &[set, path] : sets) {
+            j["config"]["datasets"][set] = path;
+        }
+        for (const auto &r : b.results) {
+            j["benchmarks"].push_back({{"name", r.name},
+                                       {"unit", r.unit},
+                                       {"value", r.value},
+                                       {"higher_is_better", r.higher_is_better},
+                                       {"samples", r.samples}});
+        }
+
+        if (output.empty()) {
+            std::cout << j.dump(4) << std::endl;
+        } else {
+            std::ofstream(output) << j.dump(4) << std::endl;
+        }
+
+        if (!baseline.is_null() && compare(b.results, baseline, tolerance)) {
+            return EXIT_FAILURE;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
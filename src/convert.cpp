@@ -0,0 +1,55 @@
+/**
+ * @file convert.cpp
+ * @author Adam Freiberg (xfreib00@stud.fit.vutbr.cz)
+ * @brief Tool for converting training data to binary format
+ * @version 0.1
+ * @date 2021-07-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include "GEDataset.h"
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+static void display_help() {
+    std::cout << '\n'
+              << "Usage: gehash-convert INPUT OUTPUT\n"
+              << "Convert training data from INPUT (text or binary) to binary "
+                 "format stored in OUTPUT.\n"
+              << "Example: gehash-convert data/train_set/train_set.data "
+                 "data/train_set/train_set.bin\n\n"
+              << "Binary file can be used by GEHash in place of text file "
+                 "(-s option). It is memory mapped, so it is loaded "
+                 "instantly and shared by concurrent runs.\n\n";
+}
+
+int main(int argc, char **argv) {
+
+    if (argc == 2 &&
+        (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help")) {
+        display_help();
+        std::exit(EXIT_SUCCESS);
+    }
+
+    if (argc != 3) {
+        std::cerr << "Invalid arguments. Use -h or --help to display help."
+                  << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    try {
+        GEDataset data(argv[1]);
+        data.save(argv[2]);
+
+        std::cout << "Converted " << data.size() << " keys from " << argv[1]
+                  << " to " << argv[2] << std::endl;
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
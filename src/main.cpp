@@ -10,14 +10,20 @@
  */
 
 #include "GEHash.h"
+#include "GEThreadPool.h"
+#include <algorithm>
 #include <cstdlib>
 #include <fstream>
 #include <functional>
 #include <getopt.h>
 #include <iostream>
+#include <mutex>
+#include <optional>
+#include <random>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
 
 static void display_help() {
     std::cout
@@ -32,7 +38,7 @@ static void display_help() {
            "FILE is used.\n"
         << "\t -o  --output\t\t Output file for GELogger. Defaults to "
            "\"ouput.json\".\n"
-        << "\t -s  --set\t\t Training data file\\path. Defaults to "
+        << "\t -s  --training\t Training data file\\path. Defaults to "
            "\"data/train_set/train_set.data\".\n"
         << "\t -g, --generations\t Max number of generations. Defaults to "
            "100.\n"
@@ -47,8 +53,57 @@ static void display_help() {
         << "\t -a  --probability\t Mutation probability between 0 and 1. "
            "Defaults to 0.1.\n"
         << "\t -f  --fitWithSum\t Use fitness with sum. Defaults to false.\n"
+        << "\t -e  --engine\t\t Backend evaluating hash functions, \"vm\", "
+           "\"jit\", \"simd\" or \"chai\". Defaults to \"vm\".\n"
+        << "\t -b  --bits\t\t Number of bits of hash table index, table has "
+           "2^bits indexes. One of 12, 16, 20 and 24. Defaults to 16.\n"
+        << "\t -r  --resolutions\t Evaluate multiple table sizes at once, "
+           "comma separated list of fold:BITS, prime:P and mulshift:BITS "
+           "(e.g. fold:12,fold:16,prime:65521). Not used by default.\n"
+        << "\t -S  --stages\t\t Evaluate on samples of training data first, "
+           "comma separated list of FRACTION:THRESHOLD (e.g. 0.01:4,0.1:2). "
+           "Only individuals with fitness at most threshold times fitness of "
+           "random function continue. Not used by default.\n"
+        << "\t -Q  --quality\t\t Compute avalanche bias, chi-square and "
+           "maximal load of table, AVALANCHE:CHI2:MAX_LOAD[:KEYS] weights of "
+           "metrics in fitness and number of sampled keys (e.g. 1:0.5:0.5), "
+           "or \"log\" to only log them. Not used by default.\n"
+        << "\t -C  --cache\t\t File of fitness cache shared by runs with "
+           "the same training data and settings. Not used by default.\n"
+        << "\t -c  --cutoff\t\t Stop evaluation of individual once its "
+           "fitness exceeds cutoff: \"worst\" of previous generation, "
+           "\"tournament\" bound or fixed number. Not used by default.\n"
+        << "\t -E  --export\t\t Export best hash function to PREFIX.hpp "
+           "(constexpr C++), PREFIX.h (C) and PREFIX_bench.cpp (benchmark "
+           "against FNV-1a, CRC32C and multiply-xorshift). Not used by "
+           "default.\n"
+        << "\t -T  --timing\t\t Log time of phases of each generation, "
+           "number of hashed keys, keys/s and peak memory usage.\n"
+        << "\t -P  --perf\t\t Log hardware performance counters (cycles, "
+           "instructions, LLC and branch misses) of reproduction and "
+           "evaluation of each generation and totals of run.\n"
+        << "\t -q  --pareto\t\t Minimize estimated cycles per key as second "
+           "objective, select by NSGA-II ranking and log non-dominated "
+           "front.\n"
+        << "\t -I  --islands\t\t Number of islands, each with population of "
+           "given size. Defaults to 1.\n"
+        << "\t -M  --migration\t Migration between islands "
+           "TOPOLOGY:INTERVAL:MIGRANTS, topology is ring or full. Defaults "
+           "to \"ring:10:1\".\n"
+        << "\t -R  --runs\t\t Number of independent runs executed "
+           "concurrently, run i writes OUTPUT with i inserted before "
+           "extension (output0.json, ...). Defaults to 1.\n"
+        << "\t -x  --seed\t\t Seed of random number generators, run i uses "
+           "seed + i. Random if not given.\n"
+        << "\t -j  --threads\t\t Number of threads used for evaluation. "
+           "Defaults to 1.\n"
+        << "\t -k  --shards\t\t Number of threads hashing training data for "
+           "single individual. Combines with --threads. Defaults to 1.\n"
         << "\t -d  --debug\t\t Use debugging mode in logger class, which "
-           "prints additional information. Not used by default.\n\n"
+           "prints additional information. Not used by default.\n"
+        << "\t -n  --ndjson\t\t Write output as one JSON line per "
+           "generation during run instead of JSON array at the end. Not used "
+           "by default.\n\n"
         << "FILE must contain grammar in BNF form. Grammar "
            "will be parsed and used for GE of hash function.\n\n";
 }
@@ -94,6 +149,17 @@ static std::string &trim(std::string &str,
     return ltrim(rtrim(str, chars), chars);
 }
 
+static std::string run_output(const std::string &path, size_t run) {
+    /* insert number of run before extension of file name */
+    const size_t slash = path.find_last_of('/');
+    size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos ||
+        (slash != std::string::npos && dot < slash)) {
+        dot = path.size();
+    }
+    return path.substr(0, dot) + std::to_string(run) + path.substr(dot);
+}
+
 int main(int argc, char **argv) {
 
     /* set options for getopt_long */
@@ -108,8 +174,26 @@ int main(int argc, char **argv) {
         {"tournament", required_argument, nullptr, 't'},
         {"probability", required_argument, nullptr, 'a'},
         {"debug", no_argument, nullptr, 'd'},
-        {"training", no_argument, nullptr, 's'},
+        {"ndjson", no_argument, nullptr, 'n'},
+        {"training", required_argument, nullptr, 's'},
         {"fitWithSum", no_argument, nullptr, 'f'},
+        {"engine", required_argument, nullptr, 'e'},
+        {"bits", required_argument, nullptr, 'b'},
+        {"resolutions", required_argument, nullptr, 'r'},
+        {"stages", required_argument, nullptr, 'S'},
+        {"quality", required_argument, nullptr, 'Q'},
+        {"cache", required_argument, nullptr, 'C'},
+        {"cutoff", required_argument, nullptr, 'c'},
+        {"export", required_argument, nullptr, 'E'},
+        {"timing", no_argument, nullptr, 'T'},
+        {"perf", no_argument, nullptr, 'P'},
+        {"pareto", no_argument, nullptr, 'q'},
+        {"islands", required_argument, nullptr, 'I'},
+        {"migration", required_argument, nullptr, 'M'},
+        {"runs", required_argument, nullptr, 'R'},
+        {"seed", required_argument, nullptr, 'x'},
+        {"threads", required_argument, nullptr, 'j'},
+        {"shards", required_argument, nullptr, 'k'},
         {"help", no_argument, nullptr, 'h'}};
 
     /* set default values of args */
@@ -123,8 +207,26 @@ int main(int argc, char **argv) {
     std::string train_data = "data/train_set/train_set.data";
     bool input_defined = false;
     bool debug = false;
+    bool ndjson = false;
+    bool timing = false;
+    bool perf = false;
+    bool pareto = false;
     double prob = 0.1;
     bool useSum = false;
+    HashEngine engine = HashEngine::VM;
+    unsigned long bits = 16;
+    std::string resolutions;
+    std::string stages;
+    std::string quality;
+    std::string cutoff;
+    std::string cache;
+    std::string exp;
+    unsigned long threads = 1;
+    unsigned long shards = 1;
+    unsigned long islands = 1;
+    std::string migration = "ring:10:1";
+    unsigned long runs = 1;
+    std::optional<uint64_t> seed;
 
     if (argc < 2) {
         std::cerr << "Not enough arguments. Use -h or --help to display help."
@@ -132,8 +234,9 @@ int main(int argc, char **argv) {
         std::exit(EXIT_FAILURE);
     }
 
-    while ((c = getopt_long(argc, argv, ":p:g:m:w:o:i:t:s:a:dfh", longopts,
-                            nullptr)) != -1) {
+    const char *optstring =
+        ":p:g:m:w:o:i:t:s:a:e:b:r:S:Q:C:c:E:I:M:R:x:j:k:dnfTPqh";
+    while ((c = getopt_long(argc, argv, optstring, longopts, nullptr)) != -1) {
         switch (c) {
         case 'p':
             try {
@@ -185,6 +288,91 @@ int main(int argc, char **argv) {
                 std::exit(EXIT_FAILURE);
             }
             break;
+        case 'b':
+            try {
+                bits = std::stoul(optarg, nullptr, 0);
+            } catch (...) {
+                std::cerr << "Invalid input, use --help option"
+                             " to display help."
+                          << std::endl;
+                std::exit(EXIT_FAILURE);
+            }
+            break;
+        case 'r':
+            resolutions = optarg;
+            break;
+        case 'S':
+            stages = optarg;
+            break;
+        case 'Q':
+            quality = optarg;
+            break;
+        case 'C':
+            cache = optarg;
+            break;
+        case 'c':
+            cutoff = optarg;
+            break;
+        case 'E':
+            exp = optarg;
+            break;
+        case 'I':
+            try {
+                islands = std::stoul(optarg, nullptr, 0);
+            } catch (...) {
+                std::cerr << "Invalid input, use --help option"
+                             " to display help."
+                          << std::endl;
+                std::exit(EXIT_FAILURE);
+            }
+            break;
+        case 'M':
+            migration = optarg;
+            break;
+        case 'j':
+            try {
+                threads = std::stoul(optarg, nullptr, 0);
+            } catch (...) {
+                std::cerr << "Invalid input, use --help option"
+                             " to display help."
+                          << std::endl;
+                std::exit(EXIT_FAILURE);
+            }
+            break;
+        case 'R':
+            try {
+                runs = std::stoul(optarg, nullptr, 0);
+            } catch (...) {
+                std::cerr << "Invalid input, use --help option"
+                             " to display help."
+                          << std::endl;
+                std::exit(EXIT_FAILURE);
+            }
+            if (runs < 1) {
+                std::cerr << "Number of runs must be at least 1." << std::endl;
+                std::exit(EXIT_FAILURE);
+            }
+            break;
+        case 'x':
+            try {
+                seed = std::stoull(optarg, nullptr, 0);
+            } catch (...) {
+                std::cerr << "Invalid input, use --help option"
+                             " to display help."
+                          << std::endl;
+                std::exit(EXIT_FAILURE);
+            }
+            break;
+        case 'k':
+            try {
+                shards = std::stoul(optarg, nullptr, 0);
+            } catch (...) {
+                std::cerr << "Invalid input, use --help option"
+                             " to display help."
+                          << std::endl;
+                std::exit(EXIT_FAILURE);
+            }
+            break;
         case 'o':
             output = optarg;
             output = trim(output);
@@ -196,7 +384,7 @@ int main(int argc, char **argv) {
             break;
         case 's':
             train_data = optarg;
-            train_data = trim(output);
+            train_data = trim(train_data);
             break;
         case 'a':
             try {
@@ -208,9 +396,37 @@ int main(int argc, char **argv) {
                 std::exit(EXIT_FAILURE);
             }
             break;
+        case 'e':
+            if (std::string(optarg) == "vm") {
+                engine = HashEngine::VM;
+            } else if (std::string(optarg) == "jit") {
+                engine = HashEngine::JIT;
+            } else if (std::string(optarg) == "simd") {
+                engine = HashEngine::SIMD;
+            } else if (std::string(optarg) == "chai") {
+                engine = HashEngine::ChaiScript;
+            } else {
+                std::cerr << "Invalid engine, use --help option"
+                             " to display help."
+                          << std::endl;
+                std::exit(EXIT_FAILURE);
+            }
+            break;
         case 'd':
             debug = true;
             break;
+        case 'n':
+            ndjson = true;
+            break;
+        case 'T':
+            timing = true;
+            break;
+        case 'P':
+            perf = true;
+            break;
+        case 'q':
+            pareto = true;
+            break;
         case 'f':
             useSum = true;
             break;
@@ -259,18 +475,70 @@ int main(int argc, char **argv) {
         input = load_grammar(input);
 
         /* configure run based on given and default parameters */
-        GEHash hash(generations, population);
-        hash.SetGrammar(input, wrap);
-        hash.SetLogger(output, debug);
-        hash.SetEvaluator(magic, train_data, useSum);
-        hash.SetTournament(t_size);
-        hash.SetProbability(prob);
+        auto run = [&](const std::shared_ptr<const GEDataset> &data,
+                       const std::string &out, const std::string &prefix,
+                       std::optional<uint64_t> run_seed) {
+            GEHash hash(generations, population);
+            hash.SetGrammar(input, wrap);
+            hash.SetLogger(out, debug, ndjson);
+            hash.SetThreads(threads, shards);
+            hash.SetResolutions(resolutions);
+            hash.SetStages(stages);
+            hash.SetQuality(quality);
+            hash.SetCache(cache);
+            hash.SetCounters(perf);
+            hash.SetEvaluator(magic, data, useSum, engine,
+                              static_cast<unsigned>(bits));
+            hash.SetTournament(t_size);
+            hash.SetCutoff(cutoff);
+            hash.SetIslands(islands, migration);
+            hash.SetExport(prefix);
+            hash.SetTiming(timing);
+            hash.SetPareto(pareto);
+            hash.SetProbability(prob);
+            if (run_seed) {
+                hash.SetSeed(*run_seed);
+            }
 
-        /* Run evolution */
-        hash.Run();
+            /* Run evolution */
+            hash.Run();
+        };
+
+        /* training data are loaded once and shared by all runs */
+        auto data = GEHash::LoadDataset(train_data);
+
+        if (runs == 1) {
+            run(data, output, exp, seed);
+            return EXIT_SUCCESS;
+        }
+
+        /* runs must differ, report seed so batch can be repeated */
+        if (!seed) {
+            std::random_device rd;
+            seed = (uint64_t{rd()} << 32) | rd();
+            std::cout << "Seed: " << *seed << std::endl;
+        }
+
+        /* each run uses threads * shards threads */
+        const unsigned long cores =
+            std::max(1u, std::thread::hardware_concurrency());
+        const unsigned long parallel =
+            std::clamp(cores / (threads * shards), 1ul, runs);
+
+        std::mutex err_mtx;
+        GEThreadPool pool(parallel);
+        pool.run(runs, [&](size_t i, size_t) {
+            try {
+                run(data, run_output(output, i),
+                    exp.empty() ? exp : run_output(exp, i), *seed + i);
+            } catch (const std::exception &e) {
+                std::lock_guard<std::mutex> lock(err_mtx);
+                std::cerr << "Run " << i << ": " << e.what() << std::endl;
+            }
+        });
     } catch (const std::exception &e) {
         std::cerr << e.what() << std::endl;
     }
 
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
@@ -10,7 +10,8 @@ import argparse
 
 def load_data(folder: str = None) -> pd.DataFrame:
     """Load data from folder to Pandas.DataFrame.
-       Read all JSON files in given folder and create DataFrame from them.
+       Read all JSON files (arrays in .json, streamed lines in .ndjson) in
+       given folder and create DataFrame from them.
 
     Args:
         dir (str, optional): Folder to read data from. Defaults to None.
@@ -27,6 +28,10 @@ def load_data(folder: str = None) -> pd.DataFrame:
                 path = os.path.join(folder, f)
                 df = pd.read_json(path)
                 dfs.append(df)
+            elif f.endswith(".ndjson"):
+                path = os.path.join(folder, f)
+                df = pd.read_json(path, lines=True)
+                dfs.append(df)
     except:
         print("error occured while loading data.")
     temp = pd.concat(dfs, ignore_index=True)
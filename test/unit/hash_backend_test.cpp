@@ -0,0 +1,313 @@
+/**
+ * @file hash_backend_test.cpp
+ * @author Adam Freiberg (xfreib00@stud.fit.vutbr.cz)
+ * @brief Unit tests of equivalence of hash function backends
+ * @version 0.1
+ * @date 2021-07-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include "GEDataset.h"
+#include "HTable.h"
+#include "HashJIT.h"
+#include "HashSIMD.h"
+#include "HashVM.h"
+#include <catch.hpp>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+using Key = GEDataset::Key;
+
+/* reference step of hash function, new hash from hash, key word and magic */
+using Step = std::function<uint64_t(uint64_t, uint64_t, uint64_t)>;
+
+static constexpr uint64_t magic = 0xCBF29CE484222325ULL;
+
+static std::vector<Key> randomKeys(size_t n) {
+    std::mt19937 rng(2021);
+    std::vector<Key> keys(n);
+    for (auto &k : keys) {
+        for (auto &w : k) {
+            w = static_cast<uint32_t>(rng());
+        }
+    }
+    /* edge values of key words */
+    keys[0].fill(0);
+    keys[1].fill(0xFFFFFFFFU);
+    keys[2].fill(0x80000000U);
+    return keys;
+}
+
+static std::vector<uint64_t> reference(const Step &step,
+                                       const std::vector<Key> &keys) {
+    std::vector<uint64_t> out;
+    for (const auto &k : keys) {
+        uint64_t hash = 0;
+        for (const uint32_t w : k) {
+            hash = step(hash, w, magic);
+        }
+        out.push_back(hash);
+    }
+    return out;
+}
+
+static std::vector<uint64_t> runVM(const HashVM &vm,
+                                   const std::vector<Key> &keys) {
+    std::vector<uint64_t> out;
+    for (const auto &k : keys) {
+        out.push_back(vm.run(k.data(), k.size(), magic));
+    }
+    return out;
+}
+
+static std::vector<uint64_t> runJIT(const HashJIT &jit,
+                                    const std::vector<Key> &keys) {
+    std::vector<uint64_t> out;
+    for (const auto &k : keys) {
+        out.push_back(jit.run(k.data(), k.size(), magic));
+    }
+    return out;
+}
+
+static std::vector<uint64_t> runSIMD(const HashSIMD &simd,
+                                     const std::vector<Key> &keys) {
+    std::vector<uint64_t> out(keys.size());
+    simd.run(keys.front().data(), keys.size(), keys.front().size(), magic,
+             out.data());
+    return out;
+}
+
+#ifdef GEHASH_USE_CHAISCRIPT
+static std::vector<uint64_t> runChai(const std::string &func,
+                                     const std::vector<Key> &keys) {
+    using Table = HTable<16, Key>;
+    Table table;
+    table.setEngine(HashEngine::ChaiScript);
+    table.setMagic(magic);
+    table.setFunc(func);
+    std::vector<uint64_t> out(keys.size());
+    for (size_t first = 0; first < keys.size(); first += Table::batch) {
+        const size_t n = std::min(Table::batch, keys.size() - first);
+        table.HashRaw(keys.data() + first, n, out.data() + first);
+    }
+    return out;
+}
+#endif
+
+/* check all native backends against reference */
+static void checkNative(const std::string &func, const Step &step) {
+    const auto keys = randomKeys(100);
+    const auto expected = reference(step, keys);
+
+    HashVM vm;
+    vm.compile(func);
+    CHECK(runVM(vm, keys) == expected);
+
+    HashSIMD simd;
+    simd.compile(vm);
+    CHECK(runSIMD(simd, keys) == expected);
+
+    HashJIT jit;
+    if (jit.compile(vm)) {
+        CHECK(runJIT(jit, keys) == expected);
+    }
+}
+
+TEST_CASE("Backends agree on mixed operand types", "[hash]") {
+    const std::vector<std::pair<std::string, Step>> cases = {
+        {"hash = hash * 31 + key;",
+         [](uint64_t h, uint64_t k, uint64_t) { return h * 31 + k; }},
+        /* key - 5 is unsigned 32-bit, zero-extended to hash */
+        {"hash = hash ^ (key - 5) >> 3;",
+         [](uint64_t h, uint64_t k, uint64_t) {
+             return h ^ (static_cast<uint32_t>(k - 5) >> 3);
+         }},
+        /* literal not fitting int is Int64, key is sign-extended */
+        {"hash = hash + key * 5000000000;",
+         [](uint64_t h, uint64_t k, uint64_t) {
+             return h + k * 5000000000ULL;
+         }},
+        {"hash = hash ^ (key - 0xFFFFFFFFu) + (key | 7u);",
+         [](uint64_t h, uint64_t k, uint64_t) {
+             return h ^ static_cast<uint32_t>(
+                            static_cast<uint32_t>(k - 0xFFFFFFFFU) +
+                            static_cast<uint32_t>(k | 7U));
+         }},
+        {"hash = (hash ^ key) * magic;",
+         [](uint64_t h, uint64_t k, uint64_t m) { return (h ^ k) * m; }},
+        {"hash = hash + magic % (key | 1);",
+         [](uint64_t h, uint64_t k, uint64_t m) { return h + m % (k | 1); }},
+    };
+
+    for (const auto &c : cases) {
+        SECTION(c.first) {
+            checkNative(c.first, c.second);
+#ifdef GEHASH_USE_CHAISCRIPT
+            const auto keys = randomKeys(100);
+            CHECK(runChai(c.first, keys) == reference(c.second, keys));
+#endif
+        }
+    }
+}
+
+TEST_CASE("Backends agree on shifts", "[hash]") {
+    /* shift amount is masked to width of type, like x86 shift
+     * instructions, so it is not compared with ChaiScript */
+    const std::vector<std::pair<std::string, Step>> cases = {
+        {"hash = hash + (key << 35);",
+         [](uint64_t h, uint64_t k, uint64_t) {
+             return h + static_cast<uint32_t>(k << 3);
+         }},
+        {"hash = hash ^ (key >> 33);",
+         [](uint64_t h, uint64_t k, uint64_t) { return h ^ (k >> 1); }},
+        {"hash = (hash << 70) + key;",
+         [](uint64_t h, uint64_t k, uint64_t) { return (h << 6) + k; }},
+        {"hash = (hash << 40) ^ key;",
+         [](uint64_t h, uint64_t k, uint64_t) { return (h << 40) ^ k; }},
+        {"hash = hash ^ (magic >> key);",
+         [](uint64_t h, uint64_t k, uint64_t m) {
+             return h ^ (m >> (k & 63));
+         }},
+        /* signed shift of Int64 is arithmetic */
+        {"hash = hash ^ ((key - 3000000000) >> 7);",
+         [](uint64_t h, uint64_t k, uint64_t) {
+             return h ^ static_cast<uint64_t>(
+                            (static_cast<int64_t>(k) - 3000000000LL) >> 7);
+         }},
+        /* signed shift of Int32 is arithmetic and sign-extended */
+        {"hash = hash + (-100 >> 3) + (-1 >> 40);",
+         [](uint64_t h, uint64_t, uint64_t) {
+             return h + static_cast<uint64_t>(-13) + static_cast<uint64_t>(-1);
+         }},
+    };
+
+    for (const auto &c : cases) {
+        SECTION(c.first) { checkNative(c.first, c.second); }
+    }
+}
+
+TEST_CASE("Backends agree on division by -1", "[hash]") {
+    const std::vector<std::pair<std::string, Step>> cases = {
+        /* -1 is converted to unsigned 32-bit maximum */
+        {"hash = hash + key / -1;",
+         [](uint64_t h, uint64_t k, uint64_t) {
+             return h + static_cast<uint32_t>(k) / 0xFFFFFFFFU;
+         }},
+        {"hash = hash ^ (key - 3000000000) / -1;",
+         [](uint64_t h, uint64_t k, uint64_t) {
+             return h ^ static_cast<uint64_t>(
+                            3000000000LL - static_cast<int64_t>(k));
+         }},
+        {"hash = hash + (key - 3000000000) % -1;",
+         [](uint64_t h, uint64_t, uint64_t) { return h; }},
+        /* minimal value divided by -1 wraps instead of trapping */
+        {"hash = hash + (key * 0 - 9223372036854775807 - 1) / -1;",
+         [](uint64_t h, uint64_t, uint64_t) {
+             return h + 0x8000000000000000ULL;
+         }},
+    };
+
+    for (const auto &c : cases) {
+        SECTION(c.first) { checkNative(c.first, c.second); }
+    }
+}
+
+TEST_CASE("Backends fail on division by zero", "[hash]") {
+    const auto keys = randomKeys(100);
+    for (const std::string func :
+         {"hash = hash + key / (key - key);", "hash = hash % (key & 0);",
+          "hash = hash + 100 / (key & 1);",
+          "hash = hash + (key - 3000000000) % (hash & 0);"}) {
+        SECTION(func) {
+            HashVM vm;
+            vm.compile(func);
+            CHECK_THROWS_AS(runVM(vm, keys), hashArithmeticError);
+
+            HashSIMD simd;
+            simd.compile(vm);
+            CHECK_THROWS_AS(runSIMD(simd, keys), hashArithmeticError);
+
+            /* JIT rejects division, VM is used instead */
+            HashJIT jit;
+            CHECK_FALSE(jit.compile(vm));
+
+#ifdef GEHASH_USE_CHAISCRIPT
+            CHECK_THROWS(runChai(func, keys));
+#endif
+        }
+    }
+}
+
+/* random expression over all operators and operand types */
+static std::string randomExpr(std::mt19937_64 &rng, int depth) {
+    static const char *const ops[] = {"+", "-", "*",  "^",  "&",
+                                      "|", "<<", ">>", "/", "%"};
+    const auto r = rng() % 10;
+    if (depth <= 0 || r < 3) {
+        switch (rng() % 7) {
+        case 0:
+            return "hash";
+        case 1:
+            return "key";
+        case 2:
+            return "magic";
+        case 3:
+            return std::to_string(rng() % 70);
+        case 4:
+            return std::to_string(rng() % 0xFFFFFFFFU) + "u";
+        case 5:
+            return std::to_string(rng() % 10000000000ULL);
+        default:
+            return "-" + std::to_string(rng() % 5);
+        }
+    }
+    if (r == 3) {
+        return "~(" + randomExpr(rng, depth - 1) + ")";
+    }
+    if (r == 4) {
+        return "-(" + randomExpr(rng, depth - 1) + ")";
+    }
+    return "(" + randomExpr(rng, depth - 1) + " " + ops[rng() % 10] + " " +
+           randomExpr(rng, depth - 1) + ")";
+}
+
+TEST_CASE("Backends agree on random functions", "[hash]") {
+    std::mt19937_64 rng(7);
+    const auto keys = randomKeys(40);
+
+    for (int i = 0; i < 2000; i++) {
+        std::string func;
+        for (int s = 0, n = 1 + static_cast<int>(rng() % 3); s < n; s++) {
+            func += "hash = " + randomExpr(rng, 5) + ";";
+        }
+        INFO(func);
+
+        HashVM vm;
+        vm.compile(func);
+        std::vector<uint64_t> expected;
+        bool failed = false;
+        try {
+            expected = runVM(vm, keys);
+        } catch (hashArithmeticError &e) {
+            failed = true;
+        }
+
+        HashSIMD simd;
+        simd.compile(vm);
+        if (failed) {
+            CHECK_THROWS_AS(runSIMD(simd, keys), hashArithmeticError);
+            continue;
+        }
+        CHECK(runSIMD(simd, keys) == expected);
+
+        HashJIT jit;
+        if (jit.compile(vm)) {
+            CHECK(runJIT(jit, keys) == expected);
+        }
+    }
+}
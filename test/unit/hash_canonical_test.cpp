@@ -0,0 +1,202 @@
+/**
+ * @file hash_canonical_test.cpp
+ * @author Adam Freiberg (xfreib00@stud.fit.vutbr.cz)
+ * @brief Unit tests of canonical form of hash functions
+ * @version 0.1
+ * @date 2021-07-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include "GEDataset.h"
+#include "HashExpr.h"
+#include "HashVM.h"
+#include "error/hashError.h"
+#include <catch.hpp>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using Key = GEDataset::Key;
+
+static constexpr uint64_t magic = 0xCBF29CE484222325ULL;
+
+static std::vector<Key> randomKeys(size_t n) {
+    std::mt19937 rng(2021);
+    std::vector<Key> keys(n);
+    for (auto &k : keys) {
+        for (auto &w : k) {
+            w = static_cast<uint32_t>(rng());
+        }
+    }
+    keys[0].fill(0);
+    keys[1].fill(0xFFFFFFFFU);
+    return keys;
+}
+
+/* hash values of all keys, empty if evaluation of any key fails */
+static std::vector<uint64_t> hashes(const std::string &func,
+                                    const std::vector<Key> &keys) {
+    HashVM vm;
+    vm.compile(func);
+    std::vector<uint64_t> out;
+    try {
+        for (const auto &k : keys) {
+            out.push_back(vm.run(k.data(), k.size(), magic));
+        }
+    } catch (hashArithmeticError &e) {
+        out.clear();
+    }
+    return out;
+}
+
+TEST_CASE("Equivalent functions share canonical key", "[canonical]") {
+    const auto keys = randomKeys(100);
+    const std::vector<std::pair<std::string, std::string>> cases = {
+        /* commutative operands */
+        {"hash = key + hash;", "hash = hash + key;"},
+        {"hash = (hash ^ key) * magic;", "hash = magic * (key ^ hash);"},
+        {"hash = (key | 7) & hash;", "hash = hash & (7 | key);"},
+        /* magic is substituted and constants are folded */
+        {"hash = hash * magic;", "hash = hash * 0xCBF29CE484222325;"},
+        {"hash = hash + (2 + 3) * key;", "hash = hash + key * 5;"},
+        /* double negation, idempotent and self-cancelling operations */
+        {"hash = ~~(hash ^ key);", "hash = (hash ^ key);"},
+        {"hash = --(hash * key);", "hash = (hash * key);"},
+        {"hash = (hash & hash) ^ (key | key);", "hash = hash ^ key;"},
+        {"hash = hash + (key - key) * 3;", "hash = hash + (key ^ key) * 3;"},
+        /* statements overwritten before use and statements without effect */
+        {"hash = hash * 31; hash = key;", "hash = key;"},
+        {"hash = key * 7; hash = key; hash = hash + 1;",
+         "hash = key; hash = hash + 1;"},
+        {"hash = hash; hash = hash ^ key; hash = hash;", "hash = hash ^ key;"},
+    };
+
+    for (const auto &c : cases) {
+        SECTION(c.first + " == " + c.second) {
+            REQUIRE(canonicalKey(c.first, magic) ==
+                    canonicalKey(c.second, magic));
+            CHECK(hashes(c.first, keys) == hashes(c.second, keys));
+        }
+    }
+}
+
+TEST_CASE("Different functions keep different canonical keys",
+          "[canonical]") {
+    const std::vector<std::pair<std::string, std::string>> cases = {
+        /* statements which may fail are never dropped */
+        {"hash = key / (key - key); hash = key;", "hash = key;"},
+        {"hash = key % (hash & 0); hash = key;", "hash = key;"},
+        {"hash = hash + key / (hash & 3) - key / (hash & 3);",
+         "hash = hash + 0;"},
+        {"hash = hash ^ key % (key & 1) ^ key % (key & 1);", "hash = hash;"},
+        /* statement reading hash depends on previous ones */
+        {"hash = key; hash = hash * 31;", "hash = hash * 31;"},
+        {"hash = key; hash = hash + key;", "hash = hash + key;"},
+        {"hash = magic; hash = hash ^ key; hash = hash * 3;",
+         "hash = hash ^ key; hash = hash * 3;"},
+        /* type of operation changes its result */
+        {"hash = hash ^ (key - 3000000000) >> 7;",
+         "hash = hash ^ (key - 3000000000u) >> 7;"},
+        {"hash = hash + (key << 35);", "hash = hash + (hash << 35);"},
+        /* non-commutative operands */
+        {"hash = hash - key;", "hash = key - hash;"},
+        {"hash = hash << key;", "hash = key << hash;"},
+    };
+
+    for (const auto &c : cases) {
+        SECTION(c.first + " != " + c.second) {
+            CHECK(canonicalKey(c.first, magic) !=
+                  canonicalKey(c.second, magic));
+        }
+    }
+}
+
+/* random expression, operands of commutative operations are swapped and
+ * idempotent or double operations are added by variant generator, so
+ * structure depends only on shape generator */
+static std::string randomExpr(std::mt19937_64 &shape,
+                              std::mt19937_64 &variant, int depth) {
+    static const char *const ops[] = {"+", "*", "^", "&", "|",
+                                      "-", "/", "%", "<<", ">>"};
+    const auto r = shape() % 8;
+    if (depth <= 0 || r < 2) {
+        switch (shape() % 5) {
+        case 0:
+            return "hash";
+        case 1:
+            return "key";
+        case 2:
+            return "magic";
+        case 3:
+            return std::to_string(shape() % 40);
+        default:
+            return std::to_string(shape() % 0xFFFFFFFFU) + "u";
+        }
+    }
+
+    std::string out;
+    if (r == 2) {
+        out = "~(" + randomExpr(shape, variant, depth - 1) + ")";
+    } else {
+        const size_t op = shape() % 10;
+        std::string a = randomExpr(shape, variant, depth - 1);
+        std::string b = randomExpr(shape, variant, depth - 1);
+        /* first five operators are commutative */
+        if (op < 5 && variant() % 2) {
+            std::swap(a, b);
+        }
+        out = "(" + a + " " + ops[op] + " " + b + ")";
+    }
+
+    switch (variant() % 6) {
+    case 0:
+        return "~~" + out;
+    case 1:
+        return "(" + out + " | " + out + ")";
+    case 2:
+        return "(" + out + " & " + out + ")";
+    default:
+        return out;
+    }
+}
+
+TEST_CASE("Equal canonical keys compute equal hashes", "[canonical]") {
+    const auto keys = randomKeys(50);
+    std::mt19937_64 variant(11);
+
+    /* hash values of first function with each canonical key */
+    std::map<std::string, std::pair<std::string, std::vector<uint64_t>>>
+        seen;
+    size_t merged = 0;
+
+    for (uint64_t seed = 0; seed < 1500; seed++) {
+        /* few variants of each shape, plus small functions which collide
+         * by chance */
+        for (int v = 0; v < 3; v++) {
+            std::mt19937_64 shape(seed);
+            const int statements = 1 + static_cast<int>(shape() % 3);
+            std::string func;
+            for (int s = 0; s < statements; s++) {
+                func += "hash = " + randomExpr(shape, variant, 3) + ";";
+            }
+
+            const std::string key = canonicalKey(func, magic);
+            const auto values = hashes(func, keys);
+            const auto it = seen.find(key);
+            if (it == seen.end()) {
+                seen.emplace(key, std::make_pair(func, values));
+                continue;
+            }
+            merged++;
+            INFO(it->second.first << " and " << func << " share " << key);
+            CHECK(values == it->second.second);
+        }
+    }
+
+    /* test is meaningful only if some functions were merged */
+    CHECK(merged > 1000);
+}